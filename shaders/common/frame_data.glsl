@@ -0,0 +1,19 @@
+// Per-frame camera block and per-object records, laid out like engine/frame_data.h
+
+layout(std140, binding = 0) uniform FrameData {
+	mat4 view;
+	mat4 proj;
+	mat4 viewProj;
+	mat4 inverseProj;
+	vec4 cameraPosition;
+	vec2 screenSize;
+	float time;
+};
+
+struct ObjectData {
+	mat4 model;
+	mat4 normalMatrix;
+	uint materialIndex;
+};
+
+layout(std430, binding = 9) readonly buffer Objects { ObjectData objects[]; };
\ No newline at end of file
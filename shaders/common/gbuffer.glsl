@@ -0,0 +1,33 @@
+// G-buffer encodings, shared by the pass writing it and the passes reading it
+
+vec2 signNotZero(vec2 v) {
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit normal folded onto an octahedron, in [0, 1] for an RG16 target
+vec2 encodeNormal(vec3 n) {
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 encoded = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return encoded * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 encoded) {
+	encoded = encoded * 2.0 - 1.0;
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.xy -= t * signNotZero(n.xy);
+	return normalize(n);
+}
+
+// View-space position of a screen point from its depth buffer value. Only the depth is
+// stored, position costs this one matrix multiply instead of an RGBA16F target.
+vec3 viewPositionFromDepth(vec2 uv, float depth, mat4 inverseProjection) {
+	vec4 position = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	return position.xyz / position.w;
+}
+
+// View-space depth at a texel of the depth buffer
+float viewDepthAt(sampler2D depthTexture, ivec2 texel, mat4 inverseProjection) {
+	vec2 uv = (vec2(texel) + 0.5) / vec2(textureSize(depthTexture, 0));
+	return viewPositionFromDepth(uv, texelFetch(depthTexture, texel, 0).r, inverseProjection).z;
+}
\ No newline at end of file
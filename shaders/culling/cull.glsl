@@ -0,0 +1,119 @@
+#version 460 core
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct Instance {
+	mat4 model;
+	vec4 minPoint;
+	vec4 maxPoint;
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint bucket;
+};
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 4) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 5) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 6) buffer DrawCounts { uint drawCounts[]; };
+layout(std430, binding = 7) readonly buffer BucketOffsets { uint bucketOffsets[]; };
+layout(std430, binding = 8) buffer OcclusionFlags { uint occluded[]; };
+
+uniform vec4 frustumPlanes[6];
+uniform int instanceCount;
+
+// Pass 0 tests against last frame's depth pyramid, pass 1 re-tests whatever
+// pass 0 rejected against the pyramid built from this frame's depth
+uniform int cullPass = 0;
+uniform bool useOcclusion = false;
+uniform int commandBase = 0;
+uniform int countBase = 0;
+
+uniform sampler2D depthPyramid;
+uniform mat4 pyramidViewProj;
+uniform vec2 pyramidSize;
+uniform int pyramidLevels;
+
+bool isInsideFrustum(vec3 minPoint, vec3 maxPoint) {
+	for (int i = 0; i < 6; i++) {
+		vec4 plane = frustumPlanes[i];
+		vec3 positive = mix(minPoint, maxPoint, greaterThan(plane.xyz, vec3(0.0)));
+
+		if (dot(plane.xyz, positive) + plane.w < 0.0) return false;
+	}
+	return true;
+}
+
+bool isOccluded(vec3 minPoint, vec3 maxPoint) {
+	vec2 screenMin = vec2(1.0), screenMax = vec2(0.0);
+	float nearestDepth = 1.0;
+
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = mix(minPoint, maxPoint, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = pyramidViewProj * vec4(corner, 1.0);
+
+		// Boxes crossing the near plane can't be projected safely
+		if (clip.w <= 0.0) return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		screenMin = min(screenMin, ndc.xy * 0.5 + 0.5);
+		screenMax = max(screenMax, ndc.xy * 0.5 + 0.5);
+		nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+	}
+	screenMin = clamp(screenMin, vec2(0.0), vec2(1.0));
+	screenMax = clamp(screenMax, vec2(0.0), vec2(1.0));
+
+	// Pick the level where the rectangle spans at most 2x2 texels, so its four
+	// corners cover every texel it touches
+	vec2 extent = (screenMax - screenMin) * pyramidSize;
+	float level = ceil(log2(max(max(extent.x, extent.y), 1.0)));
+	level = clamp(level, 0.0, float(pyramidLevels - 1));
+
+	float farthestDepth = max(
+		max(textureLod(depthPyramid, screenMin, level).x, textureLod(depthPyramid, vec2(screenMax.x, screenMin.y), level).x),
+		max(textureLod(depthPyramid, vec2(screenMin.x, screenMax.y), level).x, textureLod(depthPyramid, screenMax, level).x));
+
+	return nearestDepth > farthestDepth;
+}
+
+void emitDraw(uint index, Instance instance) {
+	// Compact survivors into their material's range of the command buffer
+	uint slot = atomicAdd(drawCounts[countBase + instance.bucket], 1);
+
+	DrawCommand command;
+	command.count = instance.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = instance.firstIndex;
+	command.baseVertex = instance.baseVertex;
+	command.baseInstance = index;
+	commands[commandBase + bucketOffsets[instance.bucket] + slot] = command;
+}
+
+void main() {
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= uint(instanceCount)) return;
+
+	Instance instance = instances[index];
+
+	if (cullPass == 1) {
+		if (occluded[index] == 0) return;
+		if (!isOccluded(instance.minPoint.xyz, instance.maxPoint.xyz)) emitDraw(index, instance);
+		return;
+	}
+
+	occluded[index] = 0;
+	if (!isInsideFrustum(instance.minPoint.xyz, instance.maxPoint.xyz)) return;
+
+	if (useOcclusion && isOccluded(instance.minPoint.xyz, instance.maxPoint.xyz)) {
+		occluded[index] = 1;
+		return;
+	}
+	emitDraw(index, instance);
+}
\ No newline at end of file
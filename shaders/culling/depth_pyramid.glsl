@@ -0,0 +1,31 @@
+#version 460 core
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(r32f, binding = 2) uniform writeonly image2D outputLevel;
+
+// Either the G-buffer's D32F depth (first level) or the previous pyramid level
+uniform sampler2D inputDepth;
+uniform int inputLevel;
+
+void main() {
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 inputTexels = textureSize(inputDepth, inputLevel);
+	ivec2 outputTexels = imageSize(outputLevel);
+	if (any(greaterThanEqual(texel, outputTexels))) return;
+
+	// Sizes aren't always exact multiples, so take the farthest depth over every
+	// input texel this output texel overlaps to stay conservative
+	vec2 ratio = vec2(inputTexels) / vec2(outputTexels);
+	ivec2 start = ivec2(floor(vec2(texel) * ratio));
+	ivec2 end = min(ivec2(ceil(vec2(texel + 1) * ratio)), inputTexels);
+
+	float depth = 0.0;
+	for (int y = start.y; y < end.y; y++) {
+		for (int x = start.x; x < end.x; x++) {
+			depth = max(depth, texelFetch(inputDepth, ivec2(x, y), inputLevel).x);
+		}
+	}
+
+	imageStore(outputLevel, texel, vec4(depth));
+}
\ No newline at end of file
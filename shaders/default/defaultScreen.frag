@@ -3,9 +3,10 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
+// Ambient occlusion, a single channel
 uniform sampler2D texture1;
 
 void main()
 {
-    FragColor = texture(texture1, TexCoords);
+    FragColor = vec4(vec3(texture(texture1, TexCoords).r), 1.0);
 }
\ No newline at end of file
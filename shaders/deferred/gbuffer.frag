@@ -1,18 +1,59 @@
-#version 430 core
+#version 460 core
+#extension GL_ARB_bindless_texture : enable
 
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedo;
+#include "../common/gbuffer.glsl"
+
+// Position isn't stored, readers rebuild it from the depth buffer
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedo;
 
-in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+flat in uint MaterialIndex;
+
+#define MATERIAL_HAS_ALBEDO 1u
+
+struct Material {
+	uvec2 albedoHandle;
+	uvec2 normalHandle;
+	uint albedoLayer;
+	uint normalLayer;
+	uint flags;
+};
+
+layout(std430, binding = 10) readonly buffer Materials { Material materials[]; };
 
+// Variants, see gBufferVariantNames. MATERIAL_TABLE reads every material from the table,
+// BINDLESS through handles instead of the array. Without the table ALBEDO_MAP is set for
+// draws whose material has a diffuse texture bound.
+uniform sampler2DArray materialTextures;
+
+// Bound per draw when the material table is off
 uniform sampler2D albedoTexture;
 
+vec4 sampleAlbedo() {
+#ifndef MATERIAL_TABLE
+#ifdef ALBEDO_MAP
+	return texture(albedoTexture, TexCoords);
+#else
+	return vec4(1.0);
+#endif
+#else
+	Material material = materials[MaterialIndex];
+	if ((material.flags & MATERIAL_HAS_ALBEDO) == 0u) return vec4(1.0);
+
+	// Handles must be dynamically uniform. Each multi-draw command is its own draw, and
+	// buildDrawBatches only instances copies sharing a material when bindless is on.
+#if defined(BINDLESS) && defined(GL_ARB_bindless_texture)
+	return texture(sampler2D(material.albedoHandle), TexCoords);
+#else
+	return texture(materialTextures, vec3(TexCoords, float(material.albedoLayer)));
+#endif
+#endif
+}
+
 void main() {
-	gPosition = FragPos;
-	gNormal = normalize(Normal);
+	gNormal = encodeNormal(normalize(Normal));
 
-	gAlbedo = texture(albedoTexture, TexCoords);
+	gAlbedo = sampleAlbedo();
 }
\ No newline at end of file
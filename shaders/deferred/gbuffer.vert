@@ -1,25 +1,27 @@
-#version 430 core
+#version 460 core
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-out vec3 FragPos;
+#include "../common/frame_data.glsl"
+
 out vec3 Normal;
 out vec2 TexCoords;
-
-uniform mat4 view;
-uniform mat4 model;
-uniform mat4 proj;
+flat out uint MaterialIndex;
 
 void main() {
-	vec4 convertedPos = view * model * vec4(aPos, 1.0);
+	// Every path passes the object index as baseInstance. gl_DrawID restarts at each
+	// multi-draw, so it would need a per-bucket offset on top. Instanced batches point
+	// baseInstance at records packed one after another.
+	ObjectData object = objects[gl_BaseInstance + gl_InstanceID];
+	vec4 convertedPos = view * object.model * vec4(aPos, 1.0);
 
-	FragPos = convertedPos.xyz;
 	TexCoords = aTexCoords;
+	MaterialIndex = object.materialIndex;
 
-	mat3 normalMatrix = mat3(transpose(inverse(view * model)));
-	Normal = normalMatrix * aNormal;
+	// The view matrix is rigid, so it transforms normals as is
+	Normal = mat3(view) * mat3(object.normalMatrix) * aNormal;
 
 	gl_Position = proj * convertedPos;
 }
\ No newline at end of file
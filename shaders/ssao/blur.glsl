@@ -1,25 +1,69 @@
 #version 430 core
 
-layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+// One pass of a separable blur. Each group covers TILE_SIZE texels of one row (horizontal)
+// or column (vertical) and stages them in shared memory with MAX_RADIUS of apron on both
+// sides, so every texel is fetched about once however large the radius.
+#ifndef TILE_SIZE
+#define TILE_SIZE 64
+#endif
+#ifndef MAX_RADIUS
+#define MAX_RADIUS 8
+#endif
 
-layout(rgba16f, binding = 1) uniform image2D blurTexture;
+layout (local_size_x = TILE_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+#include "common.glsl"
+#include "../common/frame_data.glsl"
+#include "../common/gbuffer.glsl"
+
+layout(AO_FORMAT, binding = 1) uniform writeonly image2D blurTexture;
 
-uniform int radius = 2;
-uniform vec2 texelSize;
 uniform sampler2D ssaoTexture;
+uniform sampler2D gDepth;
+
+uniform bool horizontal;
+uniform int radius = 4;
+
+// Bilateral term, neighbours across a depth edge barely count
+uniform float depthSharpness = 32.0;
+
+shared float tileAO[TILE_SIZE + 2 * MAX_RADIUS];
+shared float tileDepth[TILE_SIZE + 2 * MAX_RADIUS];
 
 void main() {
-	ivec2 texCoords = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = textureSize(ssaoTexture, 0);
+	ivec2 fullSize = textureSize(gDepth, 0);
+
+	// Group x steps along the blur direction, group y picks the row or column
+	ivec2 direction = horizontal ? ivec2(1, 0) : ivec2(0, 1);
+	ivec2 across = ivec2(1) - direction;
+	ivec2 origin = direction * int(gl_WorkGroupID.x * TILE_SIZE) + across * int(gl_WorkGroupID.y);
+
+	// Clamped at the edges, so the apron repeats the border texel
+	for (int i = int(gl_LocalInvocationIndex); i < TILE_SIZE + 2 * MAX_RADIUS; i += TILE_SIZE) {
+		ivec2 texel = clamp(origin + direction * (i - MAX_RADIUS), ivec2(0), size - 1);
+		tileAO[i] = texelFetch(ssaoTexture, texel, 0).r;
+		tileDepth[i] = viewDepthAt(gDepth, fullResTexel(texel, size, fullSize), inverseProj);
+	}
+	barrier();
+
+	ivec2 texCoords = origin + direction * int(gl_LocalInvocationIndex);
+	if (any(greaterThanEqual(texCoords, size))) return;
+
+	int center = int(gl_LocalInvocationIndex) + MAX_RADIUS;
+	int taps = min(radius, MAX_RADIUS);
+	float sigma = max(float(taps) * 0.5, 0.5);
+	float depth = tileDepth[center];
 
 	float result = 0.0;
-	for (int x = -radius; x < radius; x++) {
-		for (int y = -radius; y < radius; y++) {
-			vec2 offset = vec2(x + texCoords.x, y + texCoords.y) / texelSize;
+	float totalWeight = 0.0;
+	for (int offset = -taps; offset <= taps; offset++) {
+		float difference = abs(tileDepth[center + offset] - depth) / max(abs(depth), 1e-3);
+		float weight = exp(-float(offset * offset) / (2.0 * sigma * sigma)) * exp(-depthSharpness * difference);
 
-			result += texture(ssaoTexture, offset).x;
-		}
+		result += tileAO[center + offset] * weight;
+		totalWeight += weight;
 	}
-	result /= (radius * radius * 4);
 
-	imageStore(blurTexture, texCoords, vec4(result));
+	imageStore(blurTexture, texCoords, vec4(result / totalWeight));
 }
\ No newline at end of file
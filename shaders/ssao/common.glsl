@@ -0,0 +1,12 @@
+// Shared by the SSAO passes, which run at a fraction of the G-buffer resolution
+
+// Storage of the AO targets, r8 or r16f
+#ifndef AO_FORMAT
+#define AO_FORMAT r8
+#endif
+
+// G-buffer texel a reduced-resolution AO texel stands for. SSAO shades exactly this texel
+// and the upsample compares depths against it.
+ivec2 fullResTexel(ivec2 texel, ivec2 size, ivec2 fullSize) {
+	return min(ivec2((vec2(texel) + 0.5) * vec2(fullSize) / vec2(size)), fullSize - 1);
+}
\ No newline at end of file
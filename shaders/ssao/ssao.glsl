@@ -2,28 +2,41 @@
 
 layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
-layout(rgba16f, binding = 0) uniform image2D ssaoTexture;
+#include "common.glsl"
+#include "../common/frame_data.glsl"
+#include "../common/gbuffer.glsl"
 
-uniform sampler2D gPosition;
+layout(AO_FORMAT, binding = 0) uniform writeonly image2D ssaoTexture;
+
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
-uniform int kernelSize = 64;
+// Set by the engine, fixed at compile time so the sample loop can be unrolled
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
+
 uniform float radius = 0.5;
 uniform float bias = 0.025;
 
-uniform vec3 samples[64];
-uniform mat4 projection;
-
-const vec2 noiseScale = vec2(1920 / 4.0, 1080 / 4.0);
+uniform vec3 samples[KERNEL_SIZE];
 
 void main() {
 	ivec2 texCoords = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(ssaoTexture);
+	if (any(greaterThanEqual(texCoords, size))) return;
 
-	vec2 convertedTexCoords = vec2(float(texCoords.x) / 1920.0, float(texCoords.y) / 1080.0);
+	// Sizes come from the textures, so the pass runs at any resolution and scale. The 4x4
+	// noise tiles once every four AO texels.
+	vec2 convertedTexCoords = (vec2(texCoords) + 0.5) / vec2(size);
+	vec2 noiseScale = vec2(size) / 4.0;
 
-	vec3 fragPos = texture(gPosition, convertedTexCoords).xyz;
-	vec3 normal = normalize(texture(gNormal, convertedTexCoords).xyz);
+	ivec2 fullSize = textureSize(gDepth, 0);
+	ivec2 center = fullResTexel(texCoords, size, fullSize);
+	vec2 centerUV = (vec2(center) + 0.5) / vec2(fullSize);
+	vec3 fragPos = viewPositionFromDepth(centerUV, texelFetch(gDepth, center, 0).r, inverseProj);
+	vec3 normal = decodeNormal(texelFetch(gNormal, center, 0).xy);
 	vec3 randomVec = normalize(texture(texNoise, convertedTexCoords * noiseScale).xyz);
 
 	vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -31,21 +44,21 @@ void main() {
 	mat3 TBN = mat3(tangent, bitangent, normal);
 
 	float occlusion = 0.0f;
-	for (int i = 0; i < kernelSize; i++) {
+	for (int i = 0; i < KERNEL_SIZE; i++) {
 		vec3 samplePos = TBN * samples[i];
 		samplePos = fragPos + samplePos * radius;
 
 		vec4 offset = vec4(samplePos, 1.0);
-		offset = projection * offset;
+		offset = proj * offset;
 		offset.xyz /= offset.w;
 		offset.xyz = offset.xyz * 0.5 + 0.5;
 
-		float sampleDepth = texture(gPosition, offset.xy).z;
+		float sampleDepth = viewPositionFromDepth(offset.xy, texture(gDepth, offset.xy).r, inverseProj).z;
 
 		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
 	}
 	
-	occlusion = 1.0 - (occlusion / kernelSize);
+	occlusion = 1.0 - (occlusion / float(KERNEL_SIZE));
 	imageStore(ssaoTexture, texCoords, vec4(occlusion));
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#include "common.glsl"
+#include "../common/frame_data.glsl"
+#include "../common/gbuffer.glsl"
+
+layout(AO_FORMAT, binding = 3) uniform writeonly image2D aoTexture;
+
+uniform sampler2D lowResAO;
+uniform sampler2D gDepth;
+
+// How quickly low-resolution samples lose weight as their depth departs from this pixel's
+uniform float depthSharpness = 32.0;
+
+void main() {
+	ivec2 texCoords = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 fullSize = imageSize(aoTexture);
+	if (any(greaterThanEqual(texCoords, fullSize))) return;
+
+	ivec2 lowSize = textureSize(lowResAO, 0);
+	float depth = viewDepthAt(gDepth, texCoords, inverseProj);
+
+	// The 2x2 low-resolution texels around this pixel, weighted bilinearly and by relative
+	// depth difference so occlusion doesn't bleed across silhouettes
+	vec2 lowPos = (vec2(texCoords) + 0.5) * vec2(lowSize) / vec2(fullSize) - 0.5;
+	ivec2 base = ivec2(floor(lowPos));
+	vec2 f = lowPos - vec2(base);
+
+	float result = 0.0;
+	float totalWeight = 0.0;
+	for (int i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(base + offset, ivec2(0), lowSize - 1);
+
+		vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+		float sampleDepth = viewDepthAt(gDepth, fullResTexel(texel, lowSize, fullSize), inverseProj);
+		float difference = abs(depth - sampleDepth) / max(abs(depth), 1e-3);
+
+		float weight = (bilinear.x * bilinear.y + 1e-4) * exp(-depthSharpness * difference);
+		result += texelFetch(lowResAO, texel, 0).r * weight;
+		totalWeight += weight;
+	}
+
+	imageStore(aoTexture, texCoords, vec4(result / max(totalWeight, 1e-6)));
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "application.h"
 #include "ui/ui.h"
+#include "utils/gl_extensions.h"
+#include "utils/gl_state.h"
 
 Application::Application(GLEngine* renderer) {
     mRenderer = renderer;
@@ -51,16 +53,7 @@ void Application::init()
     gladLoadGLLoader(SDL_GL_GetProcAddress);
     SDL_GL_SetSwapInterval(1);
 
-    GLint numExtensions = 0;
-    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
-    for (int i = 0; i < numExtensions; i++) {
-        std::string extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
-        std::cout << extension << "\n";
-        if (extension == "GL_ARB_bindless_texture") {
-            std::cout << "Bindless Textures supported" << "\n";
-            break;
-        }
-    }
+    glext::load();
 
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(MessageCallback, 0);
@@ -89,7 +82,7 @@ void Application::init()
     Model newModel("../resources/objects/sponzaBasic/glTF/Sponza.gltf", GLTF);
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(0.1f));
-    newModel.model_matrix = model;
+    newModel.setTransform(model);
     mRenderer->loadModelData(newModel);
     usableObjs.push_back(newModel);
 
@@ -133,6 +126,9 @@ void Application::mainLoop()
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        // ImGui binds behind the state cache's back
+        GLState::invalidate();
+
         SDL_GL_SwapWindow(window);
     }
 }
@@ -264,8 +260,9 @@ void Application::handleClick(double xposIn, double yposIn)
 void Application::checkIntersection(glm::vec4& origin, glm::vec4& direction, glm::vec4& inverse_dir)
 {
     for (int i = 0; i < usableObjs.size(); i++) {
-        glm::vec4 boxMin = usableObjs[i].model_matrix * usableObjs[i].aabb.minPoint;
-        glm::vec4 boxMax = usableObjs[i].model_matrix * usableObjs[i].aabb.maxPoint;
+        usableObjs[i].updateBounds();
+        glm::vec4 boxMin = usableObjs[i].worldAABB.minPoint;
+        glm::vec4 boxMax = usableObjs[i].worldAABB.maxPoint;
 
         float tmin = -INFINITY, tmax = INFINITY;
         if (direction.x != 0.0f) {
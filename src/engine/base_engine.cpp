@@ -1,11 +1,14 @@
 #include "base_engine.h"
 #include "utils/functions.h"
 
+#include <algorithm>
 #include <iostream>
 #include <iterator>
 #include <SDL.h>
 #include <thread>
 #include <future>
+#include <chrono>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "imgui/imgui.h"
@@ -14,89 +17,257 @@
 #include "imgui/imgui_stdlib.h"
 #include "ImGuizmo.h"
 
+namespace {
+    // FNV-1a over the raw vertex and index data, with the sizes mixed in first
+    uint64_t hashGeometry(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+
+        size_t sizes[2] = { vertices.size(), indices.size() };
+        mix(sizes, sizeof(sizes));
+        mix(vertices.data(), sizeof(Vertex) * vertices.size());
+        mix(indices.data(), sizeof(unsigned int) * indices.size());
+        return hash;
+    }
+
+    bool sameGeometry(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+        const std::vector<Vertex>& otherVertices, const std::vector<unsigned int>& otherIndices) {
+        return vertices.size() == otherVertices.size() && indices.size() == otherIndices.size()
+            && std::memcmp(vertices.data(), otherVertices.data(), sizeof(Vertex) * vertices.size()) == 0
+            && std::memcmp(indices.data(), otherIndices.data(), sizeof(unsigned int) * indices.size()) == 0;
+    }
+
+    // Shader permutation a material needs when it is bound per draw
+    unsigned int getMaterialVariant(const MaterialPacket& material) {
+        return material.textures[SLOT_DIFFUSE] != 0 ? VARIANT_ALBEDO_MAP : 0;
+    }
+}
+
 void GLEngine::init_resources() {
     startTime = static_cast<float>(SDL_GetTicks());
 }
 void render(std::vector<Model>& objs) {}
 
-void GLEngine::drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions) {
+void GLEngine::drawModels(std::vector<Model>& models, ShaderVariants& pipeline, unsigned char drawOptions) {
     bool shouldSkipTextures = drawOptions & SKIP_TEXTURES;
     bool shouldSkipCulling = drawOptions & SKIP_CULLING;
 
     for (Model& model : models) {
-        if (!shouldSkipCulling) {
-            glm::vec4 transformedMax = model.model_matrix * model.aabb.maxPoint;
-            glm::vec4 transformedMin = model.model_matrix * model.aabb.minPoint;
-            bool shouldDraw = camera->isInsideFrustum(transformedMax, transformedMin);
-            if (!shouldDraw) continue;
-        }
-
-        for (int j = 0; j < model.meshes.size(); j++) {
-            Mesh& mesh = model.meshes[j];
-
-            glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
-            if (!shouldSkipCulling) {
-                glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
-                glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
-                bool shouldDraw = camera->isInsideFrustum(meshMax, meshMin);
-                if (!shouldDraw) continue;
+        if (model.packetsDirty) buildDrawPackets(model);
+    }
+
+    // The queue sorts by variant first, so programs only change between runs of packets
+    Shader* shader = nullptr;
+    const DrawUniforms* uniforms = nullptr;
+    auto useVariant = [&](const DrawPacket& packet) {
+        Shader& variant = pipeline.get(getVariant(packet));
+        if (&variant == shader) return;
+
+        shader = &variant;
+        shader->use();
+        uniforms = &getDrawUniforms(*shader);
+    };
+
+    if (shouldSkipCulling) {
+        unsigned int index = 0;
+        for (Model& model : models) {
+            for (unsigned int i = 0; i < model.meshes.size(); i++) {
+                useVariant(model.drawPackets[i]);
+                drawMesh(model, i, *shader, *uniforms, shouldSkipTextures, index++);
             }
+        }
+        return;
+    }
 
-            shader.setMat4("model", finalModelMatrix);
-            if (!shouldSkipTextures) {
-                Material material = model.materials_loaded[mesh.materialIndex];
+    // Sorted by buildRenderQueue, so consecutive draws mostly share their VAO and material
+    const std::vector<RenderItem>& items = renderQueue.getItems();
+    const MaterialPacket* boundMaterial = nullptr;
+    for (const DrawBatch& batch : drawBatches) {
+        const MeshRef& ref = sceneMeshes[items[batch.firstItem].index];
+        Model& model = models[ref.modelIndex];
+        const DrawPacket& packet = model.drawPackets[ref.meshIndex];
+        useVariant(packet);
 
-                if (material.textures.size() != 4) {
-                    shader.setBool("noMetallicMap", true);
-                    shader.setBool("noNormalMap", true);
-                }
-                else {
-                    shader.setBool("noMetallicMap", false);
-                    shader.setBool("noNormalMap", false);
-                }
+        if (!shouldSkipTextures) {
+            const MaterialPacket& material = model.materialPackets[packet.material];
+            if (!useMaterialTable && &material != boundMaterial) {
+                bindMaterial(material);
+                boundMaterial = &material;
+            }
+            if (packet.flags & DRAW_PACKET_SKINNED) updateBones(model, model.meshes[ref.meshIndex], *shader, *uniforms);
+        }
+
+        GLState::bindVertexArray(packet.VAO);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0,
+            batch.count, batch.baseInstance);
+        RenderStats::countDraw(packet.indexCount / 3, batch.count);
+    }
+}
 
-                for (unsigned int i = 0; i < material.textures.size(); i++) {
-                    glActiveTexture(GL_TEXTURE0 + i);
+void GLEngine::drawMesh(Model& model, unsigned int meshIndex, Shader& shader, const DrawUniforms& uniforms,
+    bool skipTextures, unsigned int objectIndex) {
+    const DrawPacket& packet = model.drawPackets[meshIndex];
 
-                    string number;
-                    string name = material.textures[i].type;
+    if (!skipTextures) {
+        if (!useMaterialTable) bindMaterial(model.materialPackets[packet.material]);
+        if (packet.flags & DRAW_PACKET_SKINNED) updateBones(model, model.meshes[meshIndex], shader, uniforms);
+    }
 
-                    string key = name;
-                    shader.setInt(key.c_str(), i);
+    // The object record is found through gl_BaseInstance
+    GLState::bindVertexArray(packet.VAO);
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0, 1, objectIndex);
+    RenderStats::countDraw(packet.indexCount / 3);
+}
 
-                    glBindTexture(GL_TEXTURE_2D, material.textures[i].id);
-                }
-                glActiveTexture(GL_TEXTURE0);
+void GLEngine::updateBones(Model& model, Mesh& mesh, Shader& shader, const DrawUniforms& uniforms) {
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mesh.SSBO);
+
+    mesh.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
+    for (unsigned int i = 0; i < mesh.bone_info.size(); i++) {
+        shader.setMat4(uniforms.boneMatrices.at(i), mesh.bone_info[i].finalTransform);
+    }
+}
+
+void GLEngine::bindMaterial(const MaterialPacket& material) {
+    for (unsigned int slot = 0; slot < SLOT_COUNT; slot++) {
+        if (material.textures[slot] == 0) continue;
+
+        GLState::bindTextureUnit(slot, material.textures[slot]);
+    }
+}
+
+void GLEngine::bindMaterial(Model& model, size_t materialIndex) {
+    if (model.packetsDirty) buildDrawPackets(model);
+    bindMaterial(model.materialPackets[materialIndex]);
+}
+
+const DrawUniforms& GLEngine::getDrawUniforms(Shader& shader) {
+    DrawUniforms& uniforms = drawUniforms[shader.ID];
+    if (uniforms.program == shader.ID) return uniforms;
+
+    uniforms.program = shader.ID;
+    uniforms.boneMatrices = shader.getUniform("boneMatrices");
 
-                if (mesh.bone_data.size() != 0 && model.scene->mAnimations > 0) {
-                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mesh.SSBO);
+    // Slot i always samples texture unit i
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        shader.setInt(shader.getUniform(materialSlotNames[slot]), slot);
+    }
+    shader.setInt(shader.getUniform("albedoTexture"), SLOT_DIFFUSE);
+    shader.setInt(shader.getUniform("materialTextures"), MATERIAL_ARRAY_UNIT);
+
+    return uniforms;
+}
 
-                    mesh.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
-                    std::string boneString = "boneMatrices[";
-                    for (unsigned int i = 0; i < mesh.bone_info.size(); i++) {
-                        shader.setMat4(boneString + std::to_string(i) + "]",
-                            mesh.bone_info[i].finalTransform);
-                    }
+void GLEngine::buildDrawPackets(Model& model) {
+    model.materialPackets.clear();
+    for (Material& material : model.materials_loaded) {
+        MaterialPacket packet = {};
+        packet.flags = material.textures.size() == 4 ? MATERIAL_PACKET_FULL : 0;
+
+        // The first texture of a kind wins when a material lists several
+        for (Texture& texture : material.textures) {
+            for (int slot = 0; slot < SLOT_COUNT; slot++) {
+                if (texture.type == materialSlotNames[slot] && packet.textures[slot] == 0) {
+                    packet.textures[slot] = texture.id;
                 }
             }
+        }
+
+        std::array<unsigned int, SLOT_COUNT + 1> key;
+        std::copy(packet.textures, packet.textures + SLOT_COUNT, key.begin());
+        key[SLOT_COUNT] = packet.flags;
+        auto iterator = materialIds.emplace(key, static_cast<unsigned int>(materialIds.size())).first;
+        packet.id = iterator->second;
+
+        model.materialPackets.push_back(packet);
+    }
+
+    model.drawPackets.clear();
+    for (Mesh& mesh : model.meshes) {
+        DrawPacket packet = {};
+        packet.VAO = mesh.buffer.VAO;
+        packet.indexCount = static_cast<unsigned int>(mesh.indices.size());
+        packet.material = static_cast<unsigned int>(mesh.materialIndex);
+        packet.geometry = mesh.geometry;
+        packet.variant = getMaterialVariant(model.materialPackets[packet.material]);
+        if (mesh.bone_data.size() != 0 && model.scene != nullptr && model.scene->mNumAnimations > 0) {
+            packet.flags |= DRAW_PACKET_SKINNED;
+        }
+        model.drawPackets.push_back(packet);
+    }
+
+    model.packetsDirty = false;
+}
+
+void GLEngine::drawIndirect(std::vector<Model>& models, GPUCulling& culling, ShaderVariants& pipeline, bool skipTextures, int pass) {
+    size_t commandBase = pass * culling.commandsPerPass;
+    size_t countBase = pass * culling.buckets.size();
+
+    GLState::bindVertexArray(culling.geometry.VAO);
+    GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, culling.getIndirectBuffer());
+    GLState::bindBuffer(GL_PARAMETER_BUFFER, culling.countBuffer);
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, culling.instanceBuffer);
+
+    // One multi-draw per material. Counts produced on the CPU let empty buckets skip their
+    // material, otherwise the number of draws comes from the cull pass.
+    for (unsigned int i = 0; i < culling.buckets.size(); i++) {
+        const MaterialBucket& bucket = culling.buckets[i];
+        int drawCount = culling.getDrawCount(pass, i);
+        if (drawCount == 0) continue;
+
+        Model& model = models[bucket.modelIndex];
+        const MaterialPacket& material = model.materialPackets[bucket.materialIndex];
+        Shader& shader = pipeline.get(frameVariant | (useMaterialTable ? 0 : getMaterialVariant(material)));
+        shader.use();
+        const DrawUniforms& uniforms = getDrawUniforms(shader);
 
-            glBindVertexArray(mesh.buffer.VAO);
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+        if (!skipTextures) {
+            if (!useMaterialTable) bindMaterial(material);
+
+            // Skinned buckets hold a single mesh, so its bones can be set like a direct draw's
+            if (bucket.skinned) updateBones(model, model.meshes[bucket.meshIndex], shader, uniforms);
+        }
+
+        void* commands = (void*)(culling.getIndirectOffset() + (commandBase + bucket.firstCommand) * sizeof(DrawElementsIndirectCommand));
+        if (drawCount > 0) {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, drawCount, sizeof(DrawElementsIndirectCommand));
+            RenderStats::countMultiDraw(culling.getTriangleCount(pass, i), static_cast<unsigned int>(drawCount));
+        }
+        else {
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, commands,
+                (countBase + i) * sizeof(unsigned int), bucket.maxCommands, sizeof(DrawElementsIndirectCommand));
+
+            // How many draws survived is only known on the GPU
+            RenderStats::countGPUMultiDraw();
         }
     }
+
 }
 
 void GLEngine::loadModelData(Model& model) {
     for (auto& info : model.textures_loaded) {
         Texture& texture = info.second;
-        int levels = (texture.type == "texture_normal" || texture.width < 16) ? 1 : 4;
-        unsigned int textureID = glutil::createTexture(texture.width, texture.height,
-            GL_UNSIGNED_BYTE, texture.nrComponents, texture.data, levels);
 
-        texture.id = textureID;
+        // Another model already uploaded this file
+        std::string key = model.directory + '/' + info.first;
+        auto cached = textureCache.find(key);
+        if (cached != textureCache.end()) {
+            texture.id = cached->second;
+        }
+        else {
+            int levels = (texture.type == "texture_normal" || texture.width < 16) ? 1 : 4;
+            texture.id = glutil::createTexture(texture.width, texture.height,
+                GL_UNSIGNED_BYTE, texture.nrComponents, texture.data, levels);
+            textureCache[key] = texture.id;
+        }
 
         stbi_image_free(texture.data);
+        texture.data = nullptr;
     }
 
     for (Material& material : model.materials_loaded) {
@@ -107,8 +278,24 @@ void GLEngine::loadModelData(Model& model) {
     }
 
     for (Mesh& mesh : model.meshes) {
-        std::vector<VertexType> endpoints = { POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID };
-        mesh.buffer = glutil::loadVertexBuffer(mesh.vertices, mesh.indices, endpoints);
+        // Repeated props, and every mesh of a model loaded twice, end up sharing one VAO
+        uint64_t hash = hashGeometry(mesh.vertices, mesh.indices);
+        auto cached = geometryCache.equal_range(hash);
+        auto match = std::find_if(cached.first, cached.second, [&](const std::pair<const uint64_t, unsigned int>& entry) {
+            const GeometryData& data = geometryData[entry.second];
+            return sameGeometry(mesh.vertices, mesh.indices, data.vertices, data.indices);
+        });
+        if (match != cached.second) {
+            mesh.geometry = match->second;
+        }
+        else {
+            std::vector<VertexType> endpoints = { POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID };
+            mesh.geometry = static_cast<unsigned int>(geometries.size());
+            geometries.push_back(glutil::loadVertexBuffer(mesh.vertices, mesh.indices, endpoints));
+            geometryData.push_back({ mesh.vertices, mesh.indices });
+            geometryCache.emplace(hash, mesh.geometry);
+        }
+        mesh.buffer = geometries[mesh.geometry];
 
         if (mesh.bone_data.size() != 0 && model.scene->mAnimations > 0) {
             glCreateBuffers(1, &mesh.SSBO);
@@ -116,13 +303,370 @@ void GLEngine::loadModelData(Model& model) {
                 mesh.bone_data.data(), GL_DYNAMIC_STORAGE_BIT);
         }
     }
+
+    buildDrawPackets(model);
+}
+
+void GLEngine::updateScene(std::vector<Model>& objs) {
+    movedMeshes.clear();
+
+    size_t meshCount = 0;
+    for (Model& model : objs) {
+        meshCount += model.meshes.size();
+    }
+
+    if (meshCount != sceneMeshes.size() || objs.size() != modelFirstMesh.size()) {
+        sceneMeshes.clear();
+        sceneBounds.clear();
+        modelFirstMesh.clear();
+        modelTransformVersions.clear();
+
+        for (unsigned int i = 0; i < objs.size(); i++) {
+            Model& model = objs[i];
+            model.updateBounds();
+            modelTransformVersions.push_back(model.transformVersion);
+
+            modelFirstMesh.push_back(static_cast<unsigned int>(sceneMeshes.size()));
+            for (unsigned int j = 0; j < model.meshes.size(); j++) {
+                sceneMeshes.push_back({ i, j });
+                sceneBounds.push_back(model.meshes[j].worldAABB);
+            }
+        }
+
+        sceneBVH.build(sceneBounds);
+        sceneVersion++;
+        return;
+    }
+
+    // Static scenes skip straight past this, only moved meshes touch the BVH
+    for (unsigned int i = 0; i < objs.size(); i++) {
+        Model& model = objs[i];
+        if (model.transformVersion == modelTransformVersions[i]) continue;
+
+        modelTransformVersions[i] = model.transformVersion;
+        model.updateBounds();
+        for (unsigned int j = 0; j < model.meshes.size(); j++) {
+            unsigned int index = modelFirstMesh[i] + j;
+            const BoundingBox& bounds = model.meshes[j].worldAABB;
+
+            if (sceneBounds[index].minPoint != bounds.minPoint || sceneBounds[index].maxPoint != bounds.maxPoint) {
+                sceneBounds[index] = bounds;
+                sceneBVH.refit(index, bounds);
+                movedMeshes.push_back(index);
+            }
+        }
+    }
+}
+
+void GLEngine::updateFrameData(const glm::mat4& proj, const glm::mat4& view) {
+    frameData.view = view;
+    frameData.proj = proj;
+    frameData.viewProj = proj * view;
+    frameData.inverseProj = glm::inverse(proj);
+    frameData.cameraPosition = glm::vec4(camera->Position, 1.0f);
+    frameData.screenSize = glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT);
+    frameData.time = animationTime;
+
+    StreamAllocation allocation = streamRing.allocate(sizeof(FrameData));
+    if (allocation.data == nullptr) return;
+
+    memcpy(allocation.data, &frameData, sizeof(FrameData));
+    streamRing.bindRange(GL_UNIFORM_BUFFER, FRAME_UBO_BINDING, allocation);
+}
+
+unsigned int GLEngine::addStaticObject(const glm::mat4& model, unsigned int materialIndex) {
+    ObjectData object = {};
+    object.model = model;
+    object.normalMatrix = glm::transpose(glm::inverse(model));
+    object.materialIndex = materialIndex;
+    staticObjects.push_back(object);
+
+    objectsDirty = true;
+    return static_cast<unsigned int>(staticObjects.size() - 1);
+}
+
+void GLEngine::updateObjects(std::vector<Model>& objs) {
+    auto writeObject = [&](unsigned int index) {
+        const MeshRef& ref = sceneMeshes[index];
+        const Model& model = objs[ref.modelIndex];
+        const Mesh& mesh = model.meshes[ref.meshIndex];
+
+        ObjectData& object = objectData[index];
+        object.model = mesh.model_matrix * model.model_matrix;
+        object.normalMatrix = glm::transpose(glm::inverse(object.model));
+        object.materialIndex = materialTable.getIndex(ref.modelIndex, mesh.materialIndex);
+    };
+
+    if (materialTable.needsBuild(objs)) {
+        materialTable.build(objs);
+        objectsDirty = true;
+    }
+
+    if (objectVersion != sceneVersion || objectsDirty) {
+        objectVersion = sceneVersion;
+        objectsDirty = false;
+        objectData.resize(sceneMeshes.size());
+        parallelFor(sceneMeshes.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) writeObject(static_cast<unsigned int>(i));
+        });
+        objectData.insert(objectData.end(), staticObjects.begin(), staticObjects.end());
+
+        // Room for one instanced copy of every scene mesh after the records themselves
+        instanceBase = static_cast<unsigned int>(objectData.size());
+    }
+    else {
+        parallelFor(movedMeshes.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) writeObject(movedMeshes[i]);
+        });
+    }
+
+    // Last frame's copy may still be read by the GPU, so every frame gets a fresh one
+    objectStream = streamRing.allocate(sizeof(ObjectData) * std::max<size_t>(objectData.size() + sceneMeshes.size(), 1));
+    if (objectStream.data == nullptr) return;
+
+    memcpy(objectStream.data, objectData.data(), sizeof(ObjectData) * objectData.size());
+    streamRing.bindRange(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectStream);
+}
+
+size_t GLEngine::getStreamSize() const {
+    // Frame block, object records with their instance staging area
+    return streamRing.alignedSize(sizeof(FrameData))
+        + streamRing.alignedSize(sizeof(ObjectData) * (sceneMeshes.size() * 2 + staticObjects.size() + 1));
+}
+
+void GLEngine::buildRenderQueue(std::vector<Model>& objs, unsigned int pass) {
+    renderQueue.clear();
+
+    glm::vec3 eye = camera->Position;
+    glm::vec3 front = camera->Front;
+    float invFar = 1.0f / camera->zFar;
+
+    for (Model& model : objs) {
+        if (model.packetsDirty) buildDrawPackets(model);
+    }
+
+    renderQueue.resize(visibleMeshes.size());
+    parallelFor(visibleMeshes.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int index = visibleMeshes[i];
+            const MeshRef& ref = sceneMeshes[index];
+
+            // View depth of the box's nearest point, so large meshes around the camera sort first
+            const BoundingBox& bounds = sceneBounds[index];
+            glm::vec3 center = glm::vec3(bounds.minPoint + bounds.maxPoint) * 0.5f;
+            glm::vec3 extent = glm::vec3(bounds.maxPoint - bounds.minPoint) * 0.5f;
+            float depth = glm::dot(center - eye, front) - glm::dot(extent, glm::abs(front));
+
+            // Material changes are free with the material table, leave the order to depth then
+            const Model& model = objs[ref.modelIndex];
+            const DrawPacket& packet = model.drawPackets[ref.meshIndex];
+            unsigned int material = useMaterialTable ? 0 : model.materialPackets[packet.material].id;
+
+            renderQueue.set(i, RenderQueue::makeKey(pass, getVariant(packet), material, packet.geometry, depth * invFar), index);
+        }
+    });
+
+    if (useSortedQueue) renderQueue.sort();
+    buildDrawBatches(objs);
+}
+
+void GLEngine::buildDrawBatches(std::vector<Model>& objs) {
+    drawBatches.clear();
+
+    auto packetOf = [&](const RenderItem& item) -> const DrawPacket& {
+        const MeshRef& ref = sceneMeshes[item.index];
+        return objs[ref.modelIndex].drawPackets[ref.meshIndex];
+    };
+    auto materialOf = [&](const RenderItem& item) {
+        const MeshRef& ref = sceneMeshes[item.index];
+        const Model& model = objs[ref.modelIndex];
+        return model.materialPackets[model.drawPackets[ref.meshIndex].material].id;
+    };
+
+    // The sort key puts material then geometry above depth, so copies end up next to each other.
+    // With the material table each instance reads its own material, only geometry has to match.
+    // Not with bindless handles though, those have to stay dynamically uniform across a draw.
+    bool mixMaterials = useMaterialTable && !materialTable.isBindless();
+    const std::vector<RenderItem>& items = renderQueue.getItems();
+    unsigned int instanceCount = 0;
+    for (unsigned int i = 0; i < items.size();) {
+        const DrawPacket& packet = packetOf(items[i]);
+
+        unsigned int end = i + 1;
+        if (useInstancing && !(packet.flags & DRAW_PACKET_SKINNED)) {
+            unsigned int material = materialOf(items[i]);
+            while (end < items.size() && packetOf(items[end]).geometry == packet.geometry
+                && (mixMaterials || materialOf(items[end]) == material)) {
+                end++;
+            }
+        }
+
+        if (end - i == 1) {
+            drawBatches.push_back({ i, 1, items[i].index });
+        }
+        else {
+            drawBatches.push_back({ i, end - i, instanceBase + instanceCount });
+            instanceCount += end - i;
+        }
+        i = end;
+    }
+
+    if (instanceCount == 0 || objectStream.data == nullptr) return;
+
+    // Batches own disjoint ranges of the staging area, so workers write their copies
+    // straight into the mapped ring
+    ObjectData* objects = static_cast<ObjectData*>(objectStream.data);
+    parallelFor(drawBatches.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const DrawBatch& batch = drawBatches[i];
+            if (batch.count == 1) continue;
+
+            for (unsigned int j = 0; j < batch.count; j++) {
+                objects[batch.baseInstance + j] = objectData[items[batch.firstItem + j].index];
+            }
+        }
+    });
 }
 
 void GLEngine::checkFrustum(std::vector<Model>& objs) {
+    updateScene(objs);
+
+    // Each worker culls its own slice into cullResults, joined in order so the result
+    // matches a single-threaded cull
+    ThreadPool& pool = ThreadPool::shared();
+    unsigned int sliceCount = useWorkerThreads ? pool.getThreadCount() * 4 : 1;
+
+    if (camera->shouldUseRadar) {
+        size_t meshesPerSlice = std::max<size_t>((sceneMeshes.size() + sliceCount - 1) / sliceCount, 1);
+        cullResults.resize(sliceCount);
+        parallelFor(sliceCount, 1, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) {
+                std::vector<unsigned int>& visible = cullResults[slice];
+                visible.clear();
+
+                size_t last = std::min(sceneMeshes.size(), (slice + 1) * meshesPerSlice);
+                for (size_t i = slice * meshesPerSlice; i < last; i++) {
+                    if (camera->isInsideFrustum(sceneBounds[i])) visible.push_back(static_cast<unsigned int>(i));
+                }
+            }
+        });
+    }
+    else {
+        sceneBVH.getSubtrees(sliceCount, cullRoots);
+        cullResults.resize(cullRoots.size());
+        parallelFor(cullRoots.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) {
+                cullResults[slice].clear();
+                sceneBVH.cull(camera->frustum, cullResults[slice], cullRoots[slice]);
+            }
+        });
+    }
+
+    visibleMeshes.clear();
+    for (const std::vector<unsigned int>& visible : cullResults) {
+        visibleMeshes.insert(visibleMeshes.end(), visible.begin(), visible.end());
+    }
+    RenderStats::countCulling(CULL_FRUSTUM, static_cast<unsigned int>(sceneMeshes.size()),
+        static_cast<unsigned int>(sceneMeshes.size() - visibleMeshes.size()));
+
+    for (Model& model : objs) {
+        model.shouldDraw = false;
+    }
+    for (unsigned int index : visibleMeshes) {
+        objs[sceneMeshes[index].modelIndex].shouldDraw = true;
+    }
+}
+
+void GLEngine::checkPVS(std::vector<Model>& objs) {
+    pvsCell = -1;
+    if (pvs.empty() || pvs.getMeshCount() != sceneMeshes.size()) return;
+
+    if (movedSinceBake.size() != sceneMeshes.size()) movedSinceBake.assign(sceneMeshes.size(), 0);
+    for (unsigned int index : movedMeshes) {
+        movedSinceBake[index] = 1;
+    }
+
+    pvsCell = pvs.findCell(camera->Position);
+    if (pvsCell < 0) return;
+
+    size_t kept = 0;
+    for (unsigned int index : visibleMeshes) {
+        if (movedSinceBake[index] || pvs.isVisible(pvsCell, index)) visibleMeshes[kept++] = index;
+    }
+    RenderStats::countCulling(CULL_PVS, static_cast<unsigned int>(visibleMeshes.size()),
+        static_cast<unsigned int>(visibleMeshes.size() - kept));
+    visibleMeshes.resize(kept);
+
     for (Model& model : objs) {
-        glm::vec4 transformedMax = model.model_matrix * model.aabb.maxPoint;
-        glm::vec4 transformedMin = model.model_matrix * model.aabb.minPoint;
+        model.shouldDraw = false;
+    }
+    for (unsigned int index : visibleMeshes) {
+        objs[sceneMeshes[index].modelIndex].shouldDraw = true;
+    }
+}
+
+void GLEngine::checkOcclusion(std::vector<Model>& objs) {
+    occlusionRasterizer.beginFrame(camera->getProjectionMatrix() * camera->getViewMatrix());
+
+    auto isOccluder = [&](unsigned int index) {
+        const MeshRef& ref = sceneMeshes[index];
+        const Mesh& mesh = objs[ref.modelIndex].meshes[ref.meshIndex];
+        glm::vec3 extent = glm::vec3(sceneBounds[index].maxPoint - sceneBounds[index].minPoint);
+
+        return glm::length(extent) >= occluderMinSize && mesh.indices.size() / 3 <= (size_t)maxOccluderTriangles;
+    };
+
+    // Occluders are only collected here, rasterize transforms and clips them on the pool
+    for (unsigned int index : visibleMeshes) {
+        if (!isOccluder(index)) continue;
+
+        const MeshRef& ref = sceneMeshes[index];
+        Model& model = objs[ref.modelIndex];
+        Mesh& mesh = model.meshes[ref.meshIndex];
+        occlusionRasterizer.addOccluder(mesh.vertices, mesh.indices, mesh.model_matrix * model.model_matrix);
+    }
+    occlusionRasterizer.rasterize();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OcclusionStats& stats = occlusionRasterizer.stats;
+
+    // 0 occluder, 1 tested and visible, 2 tested and hidden
+    occlusionResults.resize(visibleMeshes.size());
+    parallelFor(visibleMeshes.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            unsigned int index = visibleMeshes[i];
 
-        model.shouldDraw = camera->isInsideFrustum(transformedMax, transformedMin);
+            // Occluders would only ever pass against their own depth
+            if (isOccluder(index)) occlusionResults[i] = 0;
+            else occlusionResults[i] = occlusionRasterizer.isVisible(sceneBounds[index]) ? 1 : 2;
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < visibleMeshes.size(); i++) {
+        if (occlusionResults[i] != 0) stats.tested++;
+        if (occlusionResults[i] == 2) {
+            stats.culled++;
+            continue;
+        }
+        visibleMeshes[kept++] = visibleMeshes[i];
     }
+    visibleMeshes.resize(kept);
+
+    stats.testTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    RenderStats::countCulling(CULL_OCCLUSION, stats.tested, stats.culled);
+
+    for (Model& model : objs) {
+        model.shouldDraw = false;
+    }
+    for (unsigned int index : visibleMeshes) {
+        objs[sceneMeshes[index].modelIndex].shouldDraw = true;
+    }
+}
+
+void GLEngine::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task) {
+    if (count == 0) return;
+
+    if (useWorkerThreads) ThreadPool::shared().parallelFor(count, grain, task);
+    else task(0, count);
 }
\ No newline at end of file
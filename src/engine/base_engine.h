@@ -3,13 +3,29 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <SDL.h>
+#include <array>
+#include <functional>
+#include <map>
+#include <unordered_map>
 #include <vector>
 
 #include "utils/types.h"
 #include "utils/shader.h"
+#include "utils/shader_variants.h"
 #include "utils/camera.h"
 #include "utils/model.h"
 #include "utils/common_primitives.h"
+#include "utils/bvh.h"
+#include "utils/occlusion_rasterizer.h"
+#include "utils/pvs.h"
+#include "utils/render_stats.h"
+#include "utils/gl_state.h"
+#include "utils/thread_pool.h"
+#include "utils/stream_ring.h"
+#include "engine/gpu_culling.h"
+#include "engine/frame_data.h"
+#include "engine/material_table.h"
+#include "engine/render_queue.h"
 
 #include "ui/editor.h"
 
@@ -24,6 +40,12 @@ enum DrawOptions {
     SKIP_CULLING = (1u << 1)
 };
 
+// Uniforms the draw loops set, looked up once per program
+struct DrawUniforms {
+    unsigned int program = 0;
+    UniformHandle boneMatrices;
+};
+
 class GLEngine {
 public:
     virtual void init_resources();
@@ -33,17 +55,131 @@ public:
 
     void loadModelData(Model& model);
 
+    // Counters of the last completed frame plus rolling histories, for benchmarks and the Stats tab
+    const RenderStats& getStats() const { return renderStats; }
+
     Camera* camera = nullptr;
     int WINDOW_WIDTH = 1920, WINDOW_HEIGHT = 1080;
 
 protected:
     float shininess = 200.0f;
 
+    RenderStats renderStats;
+
     float startTime = 0.0f;
     float animationTime = 0.0f;
     int chosenAnimation = 0;
 
-    void drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions = 0);
+    // Every mesh of the scene flattened in model order, with cached world bounds
+    std::vector<MeshRef> sceneMeshes;
+    std::vector<BoundingBox> sceneBounds;
+    std::vector<unsigned int> modelFirstMesh;
+    BVH sceneBVH;
+
+    // Model::transformVersion of each model as of the last BVH refit
+    std::vector<unsigned int> modelTransformVersions;
+
+    // Bumped whenever sceneMeshes is rebuilt; movedMeshes lists refits since the last update
+    unsigned int sceneVersion = 0;
+    std::vector<unsigned int> movedMeshes;
+
+    // Indices into sceneMeshes that survived culling this frame
+    std::vector<unsigned int> visibleMeshes;
+
+    // visibleMeshes keyed by pass, pipeline, material, VAO and depth. Unsorted it keeps
+    // culling order, which is there to compare state changes against.
+    RenderQueue renderQueue;
+    bool useSortedQueue = true;
+
+    // Per-frame camera block and per-object records. Objects the engine draws itself
+    // (not part of any model) follow the scene meshes.
+    FrameData frameData = {};
+    std::vector<ObjectData> objectData;
+    std::vector<ObjectData> staticObjects;
+    unsigned int objectVersion = 0;
+    bool objectsDirty = true;
+
+    // Everything uploaded per frame is copied into this ring: the frame block, the object
+    // records and CPU-built draw commands. objectStream is this frame's copy of objectData.
+    StreamRing streamRing;
+    int framesInFlight = 3;
+    StreamAllocation objectStream;
+
+    // Shared by every model going through loadModelData. Geometry is keyed by a hash of its
+    // vertices and indices, textures by their full path, materials by the textures they bind.
+    // A hash hit is only taken after comparing against the CPU copy in geometryData.
+    struct GeometryData {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+    std::unordered_multimap<uint64_t, unsigned int> geometryCache;
+    std::vector<AllocatedBuffer> geometries;
+    std::vector<GeometryData> geometryData;
+    std::unordered_map<std::string, unsigned int> textureCache;
+    std::map<std::array<unsigned int, SLOT_COUNT + 1>, unsigned int> materialIds;
+
+    // renderQueue grouped into instanced draws. Copies of the object records of batched
+    // meshes are packed into objectStream from instanceBase on, after the scene and static objects.
+    std::vector<DrawBatch> drawBatches;
+    unsigned int instanceBase = 0;
+    bool useInstancing = true;
+
+    // Culling, sort keys and object/instance packing need no context and are split across
+    // ThreadPool::shared(). Only uploads and draws stay on the GL thread.
+    bool useWorkerThreads = true;
+    std::vector<unsigned int> cullRoots;
+    std::vector<std::vector<unsigned int>> cullResults;
+    std::vector<char> occlusionResults;
+
+    // Handles of every program drawModels and drawIndirect ran with, by program ID
+    std::unordered_map<unsigned int, DrawUniforms> drawUniforms;
+
+    // VARIANT_* flags every draw of the frame shares. Packets add their own on top
+    // unless the material table is on, then one program draws the whole scene.
+    unsigned int frameVariant = 0;
+    unsigned int getVariant(const DrawPacket& packet) const { return frameVariant | (useMaterialTable ? 0 : packet.variant); }
+
+    // Material textures come from bindless handles or a texture array instead of
+    // per-draw binds. Turning it off goes back to bindMaterial.
+    MaterialTable materialTable;
+    bool useMaterialTable = true;
+
+    // Baked visibility of the static scene. Meshes moved since the bake can't be trusted
+    // to it anymore and always pass.
+    PVS pvs;
+    bool usePVS = true;
+    int pvsCell = -1;
+    std::vector<char> movedSinceBake;
+
+    // Large meshes are rasterized into a small CPU depth buffer and everything else
+    // in visibleMeshes is tested against it
+    OcclusionRasterizer occlusionRasterizer;
+    bool useSoftwareOcclusion = false;
+    float occluderMinSize = 5.0f;
+    int maxOccluderTriangles = 4096;
+
+    void drawModels(std::vector<Model>& models, ShaderVariants& pipeline, unsigned char drawOptions = 0);
+    void drawMesh(Model& model, unsigned int meshIndex, Shader& shader, const DrawUniforms& uniforms,
+        bool skipTextures, unsigned int objectIndex);
+    void drawIndirect(std::vector<Model>& models, GPUCulling& culling, ShaderVariants& pipeline, bool skipTextures, int pass = 0);
+    void bindMaterial(const MaterialPacket& material);
+    void bindMaterial(Model& model, size_t materialIndex);
+    void updateBones(Model& model, Mesh& mesh, Shader& shader, const DrawUniforms& uniforms);
+    void buildDrawPackets(Model& model);
+    const DrawUniforms& getDrawUniforms(Shader& shader);
     void drawPlane();
+    void updateScene(std::vector<Model>& objs);
+    void updateFrameData(const glm::mat4& proj, const glm::mat4& view);
+    void updateObjects(std::vector<Model>& objs);
+    size_t getStreamSize() const;
+    unsigned int addStaticObject(const glm::mat4& model, unsigned int materialIndex = 0);
+    unsigned int getStaticObjectIndex(unsigned int object) const { return static_cast<unsigned int>(sceneMeshes.size()) + object; }
+    void buildRenderQueue(std::vector<Model>& objs, unsigned int pass);
+    void buildDrawBatches(std::vector<Model>& objs);
     void checkFrustum(std::vector<Model>& objs);
+    void checkPVS(std::vector<Model>& objs);
+    void checkOcclusion(std::vector<Model>& objs);
+
+    // Runs inline with useWorkerThreads off, for comparing frame times
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task);
 };
\ No newline at end of file
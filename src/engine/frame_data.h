@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Bindings shared with common/frame_data.glsl
+#define FRAME_UBO_BINDING 0
+#define OBJECT_BINDING 9
+
+// std140, written once per frame
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::mat4 inverseProj;
+    glm::vec4 cameraPosition;
+    glm::vec2 screenSize;
+    float time;
+    float padding;
+};
+
+// std430 record, indexed by gl_BaseInstance. Scene meshes come first in sceneMeshes
+// order, so GPU culling can use the same index as its instances.
+struct ObjectData {
+    glm::mat4 model;
+
+    // Inverse transpose of the model matrix, kept as a mat4 to sidestep mat3 padding
+    glm::mat4 normalMatrix;
+    unsigned int materialIndex;
+    unsigned int padding[3];
+};
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "gl_engine.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iterator>
 #include <SDL.h>
@@ -10,31 +12,48 @@
 #include <random>
 #include <utils/math.h>
 
+#include "utils/program_cache.h"
+#include "utils/embedded_shaders.h"
+
 void RenderEngine::init_resources() {
-    gBufferPipeline = Shader("deferred/gbuffer.vert", "deferred/gbuffer.frag");
+    gBufferPipeline = ShaderVariants("deferred/gbuffer.vert", "deferred/gbuffer.frag",
+        std::vector<std::string>(std::begin(gBufferVariantNames), std::end(gBufferVariantNames)));
     finalPipeline = Shader("default/defaultScreen.vert", "default/defaultScreen.frag");
-    ssaoPipeline = ComputeShader("ssao/ssao.glsl");
-    blurPipeline = ComputeShader("ssao/blur.glsl");
+    buildSSAOPipelines();
+    streamRing.init(1 << 20, framesInFlight);
+    pvs.load("../resources/pvs/sponza.pvs");
+
+    materialTable.init(true);
+
+    // The variant every frame starts with, compiling alongside everything else
+    gBufferPipeline.get(VARIANT_MATERIAL_TABLE | (materialTable.isBindless() ? VARIANT_BINDLESS : 0));
 
     planeBuffer = glutil::createPlane();
     planeTexture = glutil::loadTexture("../resources/textures/wood.png");
+    planeObject = addStaticObject(glm::translate(glm::mat4(1.0f), glm::vec3(0.0, -2.0, 0.0)),
+        materialTable.addMaterial(planeTexture));
 
     cubemap = EnviornmentCubemap("../resources/textures/skybox/");
     screenQuad.init();
 
-    positionTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr, 1);
-    normalTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr, 1);
+    // Looks up its uniforms, so it is the first to wait on its compiles. The ones
+    // above keep compiling in the background until they are first used.
+    gpuCulling.init();
+    gpuCulling.commandStream = &streamRing;
+
+    normalTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_SHORT, GL_RG, GL_RG16, nullptr, 1);
     albedoTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA8, nullptr, 1);
-    depthMap = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, GL_DEPTH_STENCIL, GL_DEPTH32F_STENCIL8);
+
+    // Nothing uses stencil
+    depthMap = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT32F, nullptr, 1);
 
     glCreateFramebuffers(1, &gBuffer);
-    glNamedFramebufferTexture(gBuffer, GL_COLOR_ATTACHMENT0, positionTexture, 0);
-    glNamedFramebufferTexture(gBuffer, GL_COLOR_ATTACHMENT1, normalTexture, 0);
-    glNamedFramebufferTexture(gBuffer, GL_COLOR_ATTACHMENT2, albedoTexture, 0);
+    glNamedFramebufferTexture(gBuffer, GL_COLOR_ATTACHMENT0, normalTexture, 0);
+    glNamedFramebufferTexture(gBuffer, GL_COLOR_ATTACHMENT1, albedoTexture, 0);
 
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glNamedFramebufferDrawBuffers(gBuffer, 3, attachments);
-    glNamedFramebufferTexture(gBuffer, GL_DEPTH_STENCIL_ATTACHMENT, depthMap, 0);
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(gBuffer, 2, attachments);
+    glNamedFramebufferTexture(gBuffer, GL_DEPTH_ATTACHMENT, depthMap, 0);
 
     GLint fbStatus = glCheckNamedFramebufferStatus(gBuffer, GL_FRAMEBUFFER);
     if (fbStatus != GL_FRAMEBUFFER_COMPLETE) {
@@ -43,38 +62,121 @@ void RenderEngine::init_resources() {
 
     std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
-    
-    for (unsigned int i = 0; i < 64; i++) {
+
+    for (unsigned int i = 0; i < 16; i++) {
+        glm::vec3 noise(
+            randomFloats(generator) * 2.0 - 1.0,
+            randomFloats(generator) * 2.0 - 1.0,
+            0.0f
+        );
+
+        ssaoNoise.push_back(noise);
+    }
+
+    noiseTexture = glutil::createTexture(4, 4, GL_FLOAT, GL_RGBA, GL_RGBA16F, ssaoNoise.data(), 1);
+
+    createSSAOTargets();
+
+    if (useHotReload) shaderWatcher.start(ProgramBuilder::directory);
+}
+
+void RenderEngine::buildSSAOPipelines() {
+    // Settings changes rebuild everything, the old programs can go
+    for (ComputeShader* pipeline : { &ssaoPipeline, &blurPipeline, &upsamplePipeline }) {
+        if (pipeline->ID != 0) GLState::deleteProgram(pipeline->ID);
+    }
+
+    ShaderDefines defines = { { "AO_FORMAT", ssaoHighPrecision ? "r16f" : "r8" } };
+    ShaderDefines ssaoDefines = defines;
+    ssaoDefines["KERNEL_SIZE"] = std::to_string(ssaoKernelSize);
+    ShaderDefines blurDefines = defines;
+    blurDefines["MAX_RADIUS"] = std::to_string(maxBlurRadius);
+    blurDefines["TILE_SIZE"] = std::to_string(blurTileSize);
+
+    ssaoPipeline = ComputeShader("ssao/ssao.glsl", ssaoDefines);
+    blurPipeline = ComputeShader("ssao/blur.glsl", blurDefines);
+    upsamplePipeline = ComputeShader("ssao/upsample.glsl", defines);
+
+    std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
+    std::default_random_engine generator;
+
+    ssaoKernel.clear();
+    for (int i = 0; i < ssaoKernelSize; i++) {
         glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0,
             randomFloats(generator) * 2.0 - 1.0,
             randomFloats(generator));
         sample = glm::normalize(sample);
         sample *= randomFloats(generator);
 
-        float scale = i / 64.0;
+        float scale = i / float(ssaoKernelSize);
         scale = lerp(0.1, 1.0f, scale * scale);
         sample *= scale;
 
         ssaoKernel.push_back(sample);
     }
 
-    for (unsigned int i = 0; i < 16; i++) {
-        glm::vec3 noise(
-            randomFloats(generator) * 2.0 - 1.0,
-            randomFloats(generator) * 2.0 - 1.0,
-            0.0f
-        );
+    ssaoKernelDirty = true;
+}
 
-        ssaoNoise.push_back(noise);
+void RenderEngine::createSSAOTargets() {
+    unsigned int textures[] = { ssaoTexture, blurTexture, blurTempTexture, aoTexture };
+    GLState::deleteTextures(4, textures);
+
+    // AO is one value per pixel, 8 bits hold it once blurred
+    GLenum format = getAOFormat();
+    ssaoWidth = std::max(WINDOW_WIDTH / ssaoScale, 1);
+    ssaoHeight = std::max(WINDOW_HEIGHT / ssaoScale, 1);
+
+    ssaoTexture = glutil::createTexture(ssaoWidth, ssaoHeight, GL_FLOAT, GL_RED, format, nullptr, 1);
+    glBindImageTexture(0, ssaoTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
+
+    // The blur passes bind their own output
+    blurTexture = glutil::createTexture(ssaoWidth, ssaoHeight, GL_FLOAT, GL_RED, format, nullptr, 1);
+    blurTempTexture = glutil::createTexture(ssaoWidth, ssaoHeight, GL_FLOAT, GL_RED, format, nullptr, 1);
+
+    // At full resolution the blurred result is used as is
+    aoTexture = 0;
+    if (ssaoScale > 1) {
+        aoTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RED, format, nullptr, 1);
+        glBindImageTexture(3, aoTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, format);
     }
+}
 
-    noiseTexture = glutil::createTexture(4, 4, GL_FLOAT, GL_RGBA, GL_RGBA16F, ssaoNoise.data(), 1);
+void RenderEngine::reloadShaders() {
+    std::vector<std::string> changed = shaderWatcher.poll();
+
+    Shader* shaders[] = { &finalPipeline, &cubemap.pipeline };
+    ComputeShader* computeShaders[] = { &ssaoPipeline, &blurPipeline, &upsamplePipeline };
+    for (const std::string& file : changed) {
+        std::cout << "Shader changed: " << file << "\n";
+        ProgramBuilder::overrideFile(file);
+        gBufferPipeline.reload(file);
+        for (Shader* shader : shaders) {
+            if (shader->usesFile(file)) shader->reload();
+        }
+        for (ComputeShader* shader : computeShaders) {
+            if (shader->usesFile(file)) shader->reload();
+        }
+    }
 
-    ssaoTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F);
-    glBindImageTexture(0, ssaoTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+    bool changedProgram = gBufferPipeline.applyReload();
+    for (Shader* shader : shaders) {
+        changedProgram |= shader->applyReload();
+    }
+    if (blurPipeline.applyReload()) changedProgram = true;
+    if (upsamplePipeline.applyReload()) changedProgram = true;
+    if (ssaoPipeline.applyReload()) {
+        ssaoKernelDirty = true;
+        changedProgram = true;
+    }
+    gpuCulling.reloadShaders(changed);
 
-    blurTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F);
-    glBindImageTexture(1, blurTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+    // Handles cached per program are stale now. Deleting the old programs already
+    // dropped them from GLState, invalidating it catches anything bound through them.
+    if (changedProgram) {
+        drawUniforms.clear();
+        GLState::invalidate();
+    }
 }
 
 void RenderEngine::render(std::vector<Model>& objs) {
@@ -83,66 +185,173 @@ void RenderEngine::render(std::vector<Model>& objs) {
 
     glm::mat4 proj = camera->getProjectionMatrix();
     glm::mat4 view = camera->getViewMatrix();
-    glm::mat4 model = glm::mat4(1.0f);
 
-    checkFrustum(objs);
+    if (useHotReload) reloadShaders();
+
+    RenderStats::active = &renderStats;
+    renderStats.beginFrame();
+    renderStats.beginPass("Culling");
+
+    if (useGPUCulling) {
+        updateScene(objs);
+    }
+    else {
+        checkFrustum(objs);
+        if (usePVS) checkPVS(objs);
+        if (useSoftwareOcclusion) checkOcclusion(objs);
+    }
+
+    frameVariant = useMaterialTable ? VARIANT_MATERIAL_TABLE | (materialTable.isBindless() ? VARIANT_BINDLESS : 0) : 0;
+
+    // The CPU path shares the merged geometry and material buckets of the GPU path. Buckets
+    // go by the material id shared across models, or with the material table only by shader
+    // variant, so repeated models add draws to existing multi-draws instead of new ones.
+    bool drawIndirectScene = useGPUCulling || useMultiDraw;
+    if (drawIndirectScene && (gpuCulling.sceneVersion != sceneVersion || bucketsUseMaterialTable != useMaterialTable)) {
+        bucketKeys.resize(sceneMeshes.size());
+        for (size_t i = 0; i < sceneMeshes.size(); i++) {
+            Model& model = objs[sceneMeshes[i].modelIndex];
+            if (model.packetsDirty) buildDrawPackets(model);
+
+            const DrawPacket& packet = model.drawPackets[sceneMeshes[i].meshIndex];
+            bucketKeys[i] = useMaterialTable ? getVariant(packet) : model.materialPackets[packet.material].id;
+        }
+
+        gpuCulling.build(objs, sceneMeshes, bucketKeys, sceneVersion);
+        bucketsUseMaterialTable = useMaterialTable;
+    }
+
+    if (gpuCulling.sceneVersion == sceneVersion) {
+        for (unsigned int index : movedMeshes) {
+            const MeshRef& ref = sceneMeshes[index];
+            gpuCulling.updateInstance(index, objs[ref.modelIndex], objs[ref.modelIndex].meshes[ref.meshIndex]);
+        }
+    }
+
+    // Waits here if the GPU is still reading the region from framesInFlight frames ago
+    streamRing.beginFrame(getStreamSize() + streamRing.alignedSize(gpuCulling.getStreamSize()));
+    updateFrameData(proj, view);
+    updateObjects(objs);
+    if (!useGPUCulling) buildRenderQueue(objs, 0);
 
     glClearColor(1.0, 0.0, 0.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        gBufferPipeline.use();
-        gBufferPipeline.setMat4("proj", proj);
-        gBufferPipeline.setMat4("view", view);
-        gBufferPipeline.setMat4("model", model);
+    GLState::bindFramebuffer(gBuffer);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (useGPUCulling) {
+            gpuCulling.cull(camera->frustum);
+        }
+        else if (useMultiDraw) {
+            gpuCulling.submit(renderQueue.getItems(), drawBatches);
+        }
+
+        renderStats.beginPass("G-Buffer");
+        if (useMaterialTable) materialTable.bind();
+        if (drawIndirectScene) {
+            drawIndirect(objs, gpuCulling, gBufferPipeline, false);
+        }
         renderScene(objs, gBufferPipeline, false);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        // Meshes held back by last frame's pyramid get a second chance against this frame's depth
+        if (useGPUCulling && gpuCulling.useOcclusion) {
+            renderStats.beginPass("Hi-Z occlusion");
+            gpuCulling.buildDepthPyramid(depthMap, WINDOW_WIDTH, WINDOW_HEIGHT, proj * view);
+            gpuCulling.cullOccluded();
+
+            drawIndirect(objs, gpuCulling, gBufferPipeline, false, 1);
+        }
+    GLState::bindFramebuffer(0);
 
+
+    renderStats.beginPass("SSAO");
     ssaoPipeline.use();
-    glBindTextureUnit(0, positionTexture);
-    glBindTextureUnit(1, normalTexture);
-    glBindTextureUnit(2, noiseTexture);
-    ssaoPipeline.setInt("gPosition", 0);
+    GLState::bindTextureUnit(0, depthMap);
+    GLState::bindTextureUnit(1, normalTexture);
+    GLState::bindTextureUnit(2, noiseTexture);
+    ssaoPipeline.setInt("gDepth", 0);
     ssaoPipeline.setInt("gNormal", 1);
     ssaoPipeline.setInt("texNoise", 2);
-    for (int i = 0; i < 64; i++) {
-        ssaoPipeline.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel.at(i));
-    }
-    ssaoPipeline.setMat4("projection", proj);
+    ssaoPipeline.setFloat("radius", ssaoRadius);
+    ssaoPipeline.setFloat("bias", ssaoBias);
 
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    glDispatchCompute(WINDOW_WIDTH / warpSize.x, WINDOW_HEIGHT / warpSize.y, warpSize.z);
+    // Uniforms live in the program, so the kernel only has to be uploaded once per build
+    if (ssaoKernelDirty) {
+        ssaoPipeline.setVec3Array("samples", ssaoKernel.data(), static_cast<int>(ssaoKernel.size()));
+        ssaoKernelDirty = false;
+    }
 
-    blurPipeline.use();
-    glBindTextureUnit(0, ssaoTexture);
-    blurPipeline.setInt("ssaoTexture", 0);
-    blurPipeline.setVec2("texelSize", glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT));
+    // Rounded up, the shaders skip invocations past the edge
+    auto groups = [](int size, float groupSize) {
+        return static_cast<unsigned int>(std::ceil(size / groupSize));
+    };
 
     glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    glDispatchCompute(WINDOW_WIDTH / warpSize.x, WINDOW_HEIGHT / warpSize.y, warpSize.z);
+    glDispatchCompute(groups(ssaoWidth, warpSize.x), groups(ssaoHeight, warpSize.y), 1);
+    RenderStats::countDispatch();
+
+    // A radius of 0 leaves the raw AO
+    unsigned int resolvedAO = ssaoTexture;
+    if (blurRadius > 0) {
+        renderStats.beginPass("Blur");
+        blurPipeline.use();
+        GLState::bindTextureUnit(1, depthMap);
+        blurPipeline.setInt("ssaoTexture", 0);
+        blurPipeline.setInt("gDepth", 1);
+        blurPipeline.setInt("radius", blurRadius);
+        blurPipeline.setFloat("depthSharpness", blurSharpness);
+
+        // Groups of blurTileSize along a row, then along a column
+        for (int pass = 0; pass < 2; pass++) {
+            bool horizontal = pass == 0;
+            GLState::bindTextureUnit(0, horizontal ? ssaoTexture : blurTempTexture);
+            glBindImageTexture(1, horizontal ? blurTempTexture : blurTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, getAOFormat());
+            blurPipeline.setBool("horizontal", horizontal);
+
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+            if (horizontal) glDispatchCompute((ssaoWidth + blurTileSize - 1) / blurTileSize, ssaoHeight, 1);
+            else glDispatchCompute((ssaoHeight + blurTileSize - 1) / blurTileSize, ssaoWidth, 1);
+            RenderStats::countDispatch();
+        }
+        resolvedAO = blurTexture;
+    }
+
+    if (ssaoScale > 1) {
+        renderStats.beginPass("AO upsample");
+        upsamplePipeline.use();
+        GLState::bindTextureUnit(0, resolvedAO);
+        GLState::bindTextureUnit(1, depthMap);
+        upsamplePipeline.setInt("lowResAO", 0);
+        upsamplePipeline.setInt("gDepth", 1);
+        upsamplePipeline.setFloat("depthSharpness", upsampleSharpness);
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        glDispatchCompute(groups(WINDOW_WIDTH, warpSize.x), groups(WINDOW_HEIGHT, warpSize.y), 1);
+        RenderStats::countDispatch();
+    }
 
+    renderStats.beginPass("Composite");
     finalPipeline.use();
-    glBindTextureUnit(0, blurTexture);
+    GLState::bindTextureUnit(0, ssaoScale > 1 ? aoTexture : resolvedAO);
     finalPipeline.setInt("blurTexture", 0);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
     screenQuad.draw();
+    RenderStats::countDraw(2);
+
+    streamRing.endFrame();
 }
 
-void RenderEngine::renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures) {
-    drawModels(objs, shader, skipTextures & SKIP_TEXTURES);
+void RenderEngine::renderScene(std::vector<Model>& objs, ShaderVariants& pipeline, bool skipTextures) {
+    if (!useGPUCulling && !useMultiDraw) drawModels(objs, pipeline, skipTextures & SKIP_TEXTURES);
 
-    glm::mat4 planeModel = glm::mat4(1.0f);
-    planeModel = glm::translate(planeModel, glm::vec3(0.0, -2.0, 0.0));
+    Shader& shader = pipeline.get(frameVariant | (useMaterialTable ? 0 : VARIANT_ALBEDO_MAP));
+    shader.use();
+    getDrawUniforms(shader);
 
-    if (!skipTextures) {
-        glBindTextureUnit(0, planeTexture);
-        shader.setInt("diffuseTexture", 0);
-    }
-    shader.setMat4("model", planeModel);
-    glBindVertexArray(planeBuffer.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (!skipTextures && !useMaterialTable) GLState::bindTextureUnit(SLOT_DIFFUSE, planeTexture);
+    GLState::bindVertexArray(planeBuffer.VAO);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, 1, getStaticObjectIndex(planeObject));
+    RenderStats::countDraw(2);
 }
 
 void RenderEngine::handleImGui() {
@@ -150,4 +359,103 @@ void RenderEngine::handleImGui() {
 
     if (ImGui::CollapsingHeader("Start Here")) {
     }
-}
+
+    if (ImGui::CollapsingHeader("Culling")) {
+        ImGui::Checkbox("GPU-driven culling", &useGPUCulling);
+        if (useGPUCulling) {
+            ImGui::Checkbox("Cull on CPU", &gpuCulling.useCPUFallback);
+            ImGui::Checkbox("Hi-Z occlusion culling", &gpuCulling.useOcclusion);
+        }
+        else {
+            ImGui::Checkbox("Multi-draw indirect", &useMultiDraw);
+            ImGui::Checkbox("Sort render queue", &useSortedQueue);
+            ImGui::Checkbox("Instance repeated meshes", &useInstancing);
+            ImGui::Checkbox("Build draw lists on workers", &useWorkerThreads);
+            if (useWorkerThreads) ImGui::Text("%u threads", ThreadPool::shared().getThreadCount());
+
+            if (!pvs.empty()) {
+                ImGui::Checkbox("Potentially visible sets", &usePVS);
+                if (usePVS && pvsCell >= 0) {
+                    ImGui::Text("Cell %d: %u / %u meshes", pvsCell, pvs.countVisible(pvsCell), pvs.getMeshCount());
+                }
+                else if (usePVS) {
+                    ImGui::Text("Camera outside baked cells");
+                }
+            }
+
+            ImGui::Checkbox("Software occlusion culling", &useSoftwareOcclusion);
+            if (useSoftwareOcclusion) {
+                ImGui::SliderFloat("Min occluder size", &occluderMinSize, 0.0f, 50.0f);
+                ImGui::SliderInt("Max occluder triangles", &maxOccluderTriangles, 64, 65536);
+
+                const OcclusionStats& stats = occlusionRasterizer.stats;
+                ImGui::Text("Occluders: %u (%u triangles)", stats.occluders, stats.triangles);
+                ImGui::Text("Culled: %u / %u (%.1f%%)", stats.culled, stats.tested, stats.cullRate() * 100.0f);
+                ImGui::Text("Raster: %.3f ms, test: %.3f ms", stats.rasterizeTime, stats.testTime);
+            }
+        }
+    }
+
+    if (ImGui::CollapsingHeader("SSAO")) {
+        const char* resolutions[] = { "Full", "Half", "Quarter" };
+        int resolution = ssaoScale == 1 ? 0 : ssaoScale == 2 ? 1 : 2;
+        if (ImGui::Combo("Resolution", &resolution, resolutions, 3)) {
+            ssaoScale = 1 << resolution;
+            createSSAOTargets();
+        }
+
+        const char* kernelSizes[] = { "16", "32", "64" };
+        int kernel = ssaoKernelSize <= 16 ? 0 : ssaoKernelSize <= 32 ? 1 : 2;
+        if (ImGui::Combo("Samples", &kernel, kernelSizes, 3)) {
+            ssaoKernelSize = 16 << kernel;
+            buildSSAOPipelines();
+        }
+
+        if (ImGui::Checkbox("16-bit targets", &ssaoHighPrecision)) {
+            createSSAOTargets();
+            buildSSAOPipelines();
+        }
+
+        ImGui::SliderFloat("Radius", &ssaoRadius, 0.05f, 2.0f);
+        ImGui::SliderFloat("Bias", &ssaoBias, 0.0f, 0.1f);
+        ImGui::SliderInt("Blur radius", &blurRadius, 0, maxBlurRadius);
+        if (blurRadius > 0) ImGui::SliderFloat("Blur depth sharpness", &blurSharpness, 1.0f, 128.0f);
+        if (ssaoScale > 1) ImGui::SliderFloat("Upsample depth sharpness", &upsampleSharpness, 1.0f, 128.0f);
+        ImGui::Text("%d x %d, %s", ssaoWidth, ssaoHeight, ssaoHighPrecision ? "R16F" : "R8");
+    }
+
+    if (ImGui::CollapsingHeader("Materials")) {
+        ImGui::Checkbox("Material table", &useMaterialTable);
+        if (materialTable.isBindless()) {
+            ImGui::Text("%zu materials, bindless handles", materialTable.size());
+        }
+        else {
+            ImGui::Text("%zu materials, %d array layers of %d px", materialTable.size(),
+                materialTable.getLayerCount(), materialTable.layerSize);
+        }
+        ImGui::Text("G-buffer variants: %zu", gBufferPipeline.size());
+    }
+
+    if (ImGui::CollapsingHeader("Streaming")) {
+        if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, 4)) {
+            streamRing.setFramesInFlight(framesInFlight);
+        }
+
+        const StreamStats& stats = streamRing.stats;
+        ImGui::Text("Region: %zu KB, used %zu KB, wasted %zu KB (peak %zu KB)", streamRing.getFrameSize() / 1024,
+            stats.used / 1024, stats.wasted / 1024, stats.peak / 1024);
+        ImGui::Text("Stalls: %u, %.3f ms total, %.3f ms last frame", stats.stalls, stats.stallTime, stats.lastStallTime);
+        ImGui::Text("Grown %u times", stats.grows);
+    }
+
+    if (ImGui::CollapsingHeader("GL State")) {
+        ImGui::Checkbox("Validate cached bindings", &GLState::debugValidation);
+        if (ImGui::Checkbox("Reload shaders on save", &useHotReload)) {
+            if (useHotReload) shaderWatcher.start(ProgramBuilder::directory);
+            else shaderWatcher.stop();
+        }
+        ImGui::Text("Program binaries: %u loaded, %u compiled", ProgramCache::hits, ProgramCache::misses);
+        ImGui::Text("Shaders: %u embedded, %zu read from %s", embeddedShaderCount, ProgramBuilder::getOverrideCount(),
+            ProgramBuilder::directory.c_str());
+    }
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "utils/compute.h"
+#include "utils/shader_watcher.h"
 #include "base_engine.h"
 
 class RenderEngine : public GLEngine {
@@ -18,24 +19,69 @@ class RenderEngine : public GLEngine {
 
         AllocatedBuffer planeBuffer;
         unsigned int planeTexture;
+        unsigned int planeObject = 0;
 
         EnviornmentCubemap cubemap;
         ScreenQuad screenQuad;
 
         unsigned int gBuffer;
-        unsigned int positionTexture, normalTexture, albedoTexture, depthMap;
+        // Octahedral normals in RG16, albedo in RGBA8 and D32F depth. View-space position is
+        // rebuilt from depth by whoever needs it, see common/gbuffer.glsl.
+        unsigned int normalTexture, albedoTexture, depthMap;
 
-        Shader gBufferPipeline, finalPipeline;
+        ShaderVariants gBufferPipeline;
+        Shader finalPipeline;
+
+        GPUCulling gpuCulling;
+        bool useGPUCulling = false;
+
+        // Bucket keys handed to gpuCulling.build, and the material mode they were made for
+        std::vector<unsigned int> bucketKeys;
+        bool bucketsUseMaterialTable = false;
+
+        // Submits CPU-culled meshes as one multi-draw per material bucket
+        bool useMultiDraw = true;
 
         glm::vec3 warpSize = glm::vec3(8.0f, 8.0f, 1.0f);
         ComputeShader ssaoPipeline;
-        unsigned int ssaoTexture;
+        unsigned int ssaoTexture = 0;
 
+        // Separable and depth-aware, ssaoTexture to blurTempTexture along rows, then on to
+        // blurTexture along columns. Cost grows linearly with the radius.
         ComputeShader blurPipeline;
-        unsigned int blurTexture;
+        unsigned int blurTexture = 0, blurTempTexture = 0;
+        int blurRadius = 4;
+        float blurSharpness = 32.0f;
+        static const int maxBlurRadius = 8;
+        // Texels per blur work group, passed to the shader as TILE_SIZE
+        static const int blurTileSize = 64;
 
+        // SSAO and its blur run at 1/ssaoScale of the window into single channel targets.
+        // A depth-aware upsample brings the result back to full resolution in aoTexture.
+        int ssaoScale = 2;
+        int ssaoWidth = 0, ssaoHeight = 0;
+        bool ssaoHighPrecision = false;
+        float ssaoRadius = 0.5f, ssaoBias = 0.025f;
+        ComputeShader upsamplePipeline;
+        unsigned int aoTexture = 0;
+        float upsampleSharpness = 32.0f;
+
+        // Compiled into the SSAO shader as KERNEL_SIZE so its loop can be unrolled
+        int ssaoKernelSize = 64;
         std::vector<glm::vec3> ssaoKernel, ssaoNoise;
+        // Set for every new SSAO program, the kernel goes up on its first dispatch so
+        // building the pipelines never waits on the link
+        bool ssaoKernelDirty = true;
         unsigned int noiseTexture;
 
-        void RenderEngine::renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures);
+        GLenum getAOFormat() const { return ssaoHighPrecision ? GL_R16F : GL_R8; }
+        void buildSSAOPipelines();
+        void createSSAOTargets();
+
+        // Saved shaders are recompiled in the background and swapped in at the start of a frame
+        ShaderWatcher shaderWatcher;
+        bool useHotReload = true;
+        void reloadShaders();
+
+        void RenderEngine::renderScene(std::vector<Model>& objs, ShaderVariants& pipeline, bool skipTextures);
 };
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "gpu_culling.h"
+#include "utils/functions.h"
+#include "utils/render_stats.h"
+#include "utils/gl_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace {
+    int previousPowerOfTwo(int value) {
+        int result = 1;
+        while (result * 2 <= value) result *= 2;
+        return result;
+    }
+}
+
+void cullInstances(const std::vector<GPUInstance>& instances, const glm::vec4 planes[6],
+    const std::vector<unsigned int>& bucketOffsets, std::vector<DrawElementsIndirectCommand>& commands,
+    std::vector<unsigned int>& drawCounts) {
+    std::fill(drawCounts.begin(), drawCounts.end(), 0);
+
+    for (unsigned int i = 0; i < instances.size(); i++) {
+        const GPUInstance& instance = instances[i];
+
+        bool visible = true;
+        for (int j = 0; j < 6 && visible; j++) {
+            glm::vec3 normal(planes[j]);
+            glm::vec3 positive(
+                normal.x > 0.0f ? instance.maxPoint.x : instance.minPoint.x,
+                normal.y > 0.0f ? instance.maxPoint.y : instance.minPoint.y,
+                normal.z > 0.0f ? instance.maxPoint.z : instance.minPoint.z);
+
+            visible = glm::dot(normal, positive) + planes[j].w >= 0.0f;
+        }
+        if (!visible) continue;
+
+        unsigned int slot = drawCounts[instance.bucket]++;
+        DrawElementsIndirectCommand& command = commands[bucketOffsets[instance.bucket] + slot];
+        command.count = instance.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = instance.firstIndex;
+        command.baseVertex = instance.baseVertex;
+        command.baseInstance = i;
+    }
+}
+
+void GPUCulling::init() {
+    cullPipeline = ComputeShader("culling/cull.glsl");
+    pyramidPipeline = ComputeShader("culling/depth_pyramid.glsl");
+    lookupUniforms();
+}
+
+void GPUCulling::lookupUniforms() {
+    cullUniforms.frustumPlanes = cullPipeline.getUniform("frustumPlanes");
+    cullUniforms.instanceCount = cullPipeline.getUniform("instanceCount");
+    cullUniforms.cullPass = cullPipeline.getUniform("cullPass");
+    cullUniforms.commandBase = cullPipeline.getUniform("commandBase");
+    cullUniforms.countBase = cullPipeline.getUniform("countBase");
+    cullUniforms.useOcclusion = cullPipeline.getUniform("useOcclusion");
+    cullUniforms.depthPyramid = cullPipeline.getUniform("depthPyramid");
+    cullUniforms.pyramidViewProj = cullPipeline.getUniform("pyramidViewProj");
+    cullUniforms.pyramidSize = cullPipeline.getUniform("pyramidSize");
+    cullUniforms.pyramidLevels = cullPipeline.getUniform("pyramidLevels");
+
+    pyramidUniforms.inputDepth = pyramidPipeline.getUniform("inputDepth");
+    pyramidUniforms.inputLevel = pyramidPipeline.getUniform("inputLevel");
+}
+
+void GPUCulling::reloadShaders(const std::vector<std::string>& changedFiles) {
+    for (const std::string& file : changedFiles) {
+        if (cullPipeline.usesFile(file)) cullPipeline.reload();
+        if (pyramidPipeline.usesFile(file)) pyramidPipeline.reload();
+    }
+
+    bool cullChanged = cullPipeline.applyReload();
+    bool pyramidChanged = pyramidPipeline.applyReload();
+    if (cullChanged || pyramidChanged) lookupUniforms();
+}
+
+void GPUCulling::releaseBuffers() {
+    if (geometry.VAO != 0) {
+        GLState::deleteVertexArrays(1, &geometry.VAO);
+        GLState::deleteBuffers(1, &geometry.VBO);
+        GLState::deleteBuffers(1, &geometry.EBO);
+        geometry = {};
+    }
+
+    unsigned int buffers[5] = { instanceBuffer, commandBuffer, countBuffer, bucketOffsetBuffer, occlusionBuffer };
+    GLState::deleteBuffers(5, buffers);
+    instanceBuffer = commandBuffer = countBuffer = bucketOffsetBuffer = occlusionBuffer = 0;
+}
+
+void GPUCulling::build(std::vector<Model>& models, const std::vector<MeshRef>& sceneMeshes,
+    const std::vector<unsigned int>& bucketKeys, unsigned int version) {
+    releaseBuffers();
+    sceneVersion = version;
+
+    instances.clear();
+    buckets.clear();
+    bucketOffsets.clear();
+    if (sceneMeshes.empty()) return;
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::map<unsigned int, unsigned int> bucketLookup;
+
+    // Geometry id to the instance that first appended it
+    std::map<unsigned int, unsigned int> geometryLookup;
+
+    for (size_t i = 0; i < sceneMeshes.size(); i++) {
+        const MeshRef& ref = sceneMeshes[i];
+        Model& model = models[ref.modelIndex];
+        Mesh& mesh = model.meshes[ref.meshIndex];
+
+        // The first mesh of a bucket stands in for its material when binding
+        unsigned int key = bucketKeys[i];
+        bool skinned = (model.drawPackets[ref.meshIndex].flags & DRAW_PACKET_SKINNED) != 0;
+        auto iterator = skinned ? bucketLookup.end() : bucketLookup.find(key);
+        unsigned int bucket;
+        if (iterator == bucketLookup.end()) {
+            bucket = static_cast<unsigned int>(buckets.size());
+            if (!skinned) bucketLookup[key] = bucket;
+            buckets.push_back({ ref.modelIndex, static_cast<unsigned int>(mesh.materialIndex), 0, 0, skinned, ref.meshIndex });
+        }
+        else {
+            bucket = iterator->second;
+        }
+        buckets[bucket].maxCommands++;
+
+        unsigned int index = static_cast<unsigned int>(instances.size());
+        GPUInstance instance;
+        instance.indexCount = static_cast<unsigned int>(mesh.indices.size());
+        instance.bucket = bucket;
+
+        auto shared = geometryLookup.find(mesh.geometry);
+        if (shared != geometryLookup.end()) {
+            instance.firstIndex = instances[shared->second].firstIndex;
+            instance.baseVertex = instances[shared->second].baseVertex;
+        }
+        else {
+            instance.firstIndex = static_cast<unsigned int>(indices.size());
+            instance.baseVertex = static_cast<int>(vertices.size());
+            geometryLookup[mesh.geometry] = index;
+
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+        }
+
+        instances.push_back(instance);
+        updateInstance(index, model, mesh);
+    }
+
+    unsigned int totalCommands = 0;
+    for (MaterialBucket& bucket : buckets) {
+        bucket.firstCommand = totalCommands;
+        bucketOffsets.push_back(totalCommands);
+        totalCommands += bucket.maxCommands;
+    }
+
+    std::vector<VertexType> endpoints = { POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID };
+    geometry = glutil::loadVertexBuffer(vertices, indices, endpoints);
+    GLState::bindVertexArray(0);
+
+    glCreateBuffers(1, &instanceBuffer);
+    glNamedBufferStorage(instanceBuffer, sizeof(GPUInstance) * instances.size(),
+        instances.data(), GL_DYNAMIC_STORAGE_BIT);
+
+    // Both cull passes get their own half so the second never overwrites draws
+    // the first has already submitted
+    commandsPerPass = totalCommands;
+    glCreateBuffers(1, &commandBuffer);
+    glNamedBufferStorage(commandBuffer, sizeof(DrawElementsIndirectCommand) * totalCommands * 2,
+        nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &countBuffer);
+    glNamedBufferStorage(countBuffer, sizeof(unsigned int) * buckets.size() * 2,
+        nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &occlusionBuffer);
+    glNamedBufferStorage(occlusionBuffer, sizeof(unsigned int) * instances.size(),
+        nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glCreateBuffers(1, &bucketOffsetBuffer);
+    glNamedBufferStorage(bucketOffsetBuffer, sizeof(unsigned int) * bucketOffsets.size(),
+        bucketOffsets.data(), GL_DYNAMIC_STORAGE_BIT);
+
+    cpuCommands.resize(totalCommands);
+    cpuDrawCounts.assign(buckets.size() * 2, 0);
+    cpuTriangleCounts.assign(buckets.size(), 0);
+    countsOnCPU = false;
+    indirectBuffer = commandBuffer;
+    indirectOffset = 0;
+}
+
+void GPUCulling::updateInstance(unsigned int index, const Model& model, const Mesh& mesh) {
+    GPUInstance& instance = instances[index];
+    instance.model = mesh.model_matrix * model.model_matrix;
+    instance.minPoint = mesh.worldAABB.minPoint;
+    instance.maxPoint = mesh.worldAABB.maxPoint;
+
+    if (instanceBuffer != 0) {
+        glNamedBufferSubData(instanceBuffer, sizeof(GPUInstance) * index, sizeof(GPUInstance), &instance);
+    }
+}
+
+void GPUCulling::cull(const Frustum& frustum) {
+    if (instances.empty()) return;
+
+    glm::vec4 planes[6];
+    frustum.getPlanes(planes);
+
+    // The fallback has no depth to test against, so its second pass stays empty
+    if (useCPUFallback) {
+        cullInstances(instances, planes, bucketOffsets, cpuCommands, cpuDrawCounts);
+        std::fill(cpuDrawCounts.begin() + buckets.size(), cpuDrawCounts.end(), 0);
+
+        unsigned int drawn = 0;
+        for (unsigned int count : cpuDrawCounts) drawn += count;
+        RenderStats::countCulling(CULL_GPU, static_cast<unsigned int>(instances.size()),
+            static_cast<unsigned int>(instances.size()) - drawn);
+
+        uploadCPUCommands();
+        return;
+    }
+
+    // Culled counts would need a readback, only the tested side is known here
+    countsOnCPU = false;
+    indirectBuffer = commandBuffer;
+    indirectOffset = 0;
+    RenderStats::countGPUCulling(CULL_GPU, static_cast<unsigned int>(instances.size()));
+
+    unsigned int zero = 0;
+    glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    cullPipeline.use();
+    cullPipeline.setVec4Array(cullUniforms.frustumPlanes, planes, 6);
+    if (!useOcclusion) hasPyramid = false;
+
+    dispatchCull(0);
+}
+
+void GPUCulling::submit(const std::vector<RenderItem>& items, const std::vector<DrawBatch>& batches) {
+    if (instances.empty()) return;
+
+    std::fill(cpuDrawCounts.begin(), cpuDrawCounts.end(), 0);
+    for (const DrawBatch& batch : batches) {
+        const GPUInstance& instance = instances[items[batch.firstItem].index];
+
+        unsigned int slot = cpuDrawCounts[instance.bucket]++;
+        DrawElementsIndirectCommand& command = cpuCommands[bucketOffsets[instance.bucket] + slot];
+        command.count = instance.indexCount;
+        command.instanceCount = batch.count;
+        command.firstIndex = instance.firstIndex;
+        command.baseVertex = instance.baseVertex;
+        command.baseInstance = batch.baseInstance;
+    }
+
+    uploadCPUCommands();
+}
+
+void GPUCulling::uploadCPUCommands() {
+    std::fill(cpuTriangleCounts.begin(), cpuTriangleCounts.end(), 0);
+    for (unsigned int i = 0; i < buckets.size(); i++) {
+        const DrawElementsIndirectCommand* commands = &cpuCommands[bucketOffsets[i]];
+        for (unsigned int j = 0; j < cpuDrawCounts[i]; j++) {
+            cpuTriangleCounts[i] += commands[j].count / 3 * commands[j].instanceCount;
+        }
+    }
+
+    countsOnCPU = true;
+
+    // Slots past a bucket's count hold stale commands, but nothing reads them. Draw counts
+    // are passed straight to glMultiDrawElementsIndirect, so countBuffer can stay stale too.
+    if (commandStream != nullptr) {
+        StreamAllocation allocation = commandStream->allocate(getStreamSize());
+        if (allocation.data != nullptr) {
+            memcpy(allocation.data, cpuCommands.data(), getStreamSize());
+            indirectBuffer = commandStream->getBuffer();
+            indirectOffset = allocation.offset;
+            return;
+        }
+    }
+
+    glNamedBufferSubData(commandBuffer, 0, getStreamSize(), cpuCommands.data());
+    indirectBuffer = commandBuffer;
+    indirectOffset = 0;
+}
+
+int GPUCulling::getDrawCount(int pass, unsigned int bucket) const {
+    return countsOnCPU ? static_cast<int>(cpuDrawCounts[pass * buckets.size() + bucket]) : -1;
+}
+
+unsigned int GPUCulling::getTriangleCount(int pass, unsigned int bucket) const {
+    return countsOnCPU && pass == 0 ? cpuTriangleCounts[bucket] : 0;
+}
+
+void GPUCulling::cullOccluded() {
+    if (instances.empty() || useCPUFallback || !hasPyramid) return;
+
+    cullPipeline.use();
+    dispatchCull(1);
+}
+
+void GPUCulling::dispatchCull(int pass) {
+    cullPipeline.setInt(cullUniforms.instanceCount, static_cast<int>(instances.size()));
+    cullPipeline.setInt(cullUniforms.cullPass, pass);
+    cullPipeline.setInt(cullUniforms.commandBase, pass * commandsPerPass);
+    cullPipeline.setInt(cullUniforms.countBase, pass * static_cast<int>(buckets.size()));
+
+    cullPipeline.setBool(cullUniforms.useOcclusion, useOcclusion && hasPyramid);
+    if (hasPyramid) {
+        GLState::bindTextureUnit(0, depthPyramid);
+        cullPipeline.setInt(cullUniforms.depthPyramid, 0);
+        cullPipeline.setMat4(cullUniforms.pyramidViewProj, pyramidViewProj);
+        cullPipeline.setVec2(cullUniforms.pyramidSize, glm::vec2(pyramidWidth, pyramidHeight));
+        cullPipeline.setInt(cullUniforms.pyramidLevels, pyramidLevels);
+    }
+
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_COUNT_BINDING, countBuffer);
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, BUCKET_OFFSET_BINDING, bucketOffsetBuffer);
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_BINDING, occlusionBuffer);
+
+    glDispatchCompute((static_cast<unsigned int>(instances.size()) + 63) / 64, 1, 1);
+    RenderStats::countDispatch();
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GPUCulling::buildDepthPyramid(unsigned int depthTexture, int width, int height, const glm::mat4& viewProj) {
+    int newWidth = previousPowerOfTwo(width);
+    int newHeight = previousPowerOfTwo(height);
+
+    if (depthPyramid == 0 || newWidth != pyramidWidth || newHeight != pyramidHeight) {
+        if (depthPyramid != 0) GLState::deleteTextures(1, &depthPyramid);
+
+        pyramidWidth = newWidth;
+        pyramidHeight = newHeight;
+        pyramidLevels = 1;
+        while ((std::max(pyramidWidth, pyramidHeight) >> pyramidLevels) > 0) pyramidLevels++;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &depthPyramid);
+        glTextureStorage2D(depthPyramid, pyramidLevels, GL_R32F, pyramidWidth, pyramidHeight);
+        glTextureParameteri(depthPyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTextureParameteri(depthPyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(depthPyramid, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(depthPyramid, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    pyramidPipeline.use();
+    pyramidPipeline.setInt(pyramidUniforms.inputDepth, 0);
+
+    for (int level = 0; level < pyramidLevels; level++) {
+        int outputWidth = std::max(pyramidWidth >> level, 1);
+        int outputHeight = std::max(pyramidHeight >> level, 1);
+
+        GLState::bindTextureUnit(0, level == 0 ? depthTexture : depthPyramid);
+        pyramidPipeline.setInt(pyramidUniforms.inputLevel, level == 0 ? 0 : level - 1);
+        glBindImageTexture(PYRAMID_IMAGE_UNIT, depthPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((outputWidth + 7) / 8, (outputHeight + 7) / 8, 1);
+        RenderStats::countDispatch();
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    pyramidViewProj = viewProj;
+    hasPyramid = true;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "utils/types.h"
+#include "utils/model.h"
+#include "utils/camera.h"
+#include "utils/compute.h"
+#include "utils/stream_ring.h"
+#include "engine/render_queue.h"
+
+// Shader storage bindings shared with culling/cull.glsl
+#define INSTANCE_BINDING 4
+#define COMMAND_BINDING 5
+#define DRAW_COUNT_BINDING 6
+#define BUCKET_OFFSET_BINDING 7
+#define OCCLUSION_BINDING 8
+#define PYRAMID_IMAGE_UNIT 2
+
+// Layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// std430 record, one per scene mesh
+struct GPUInstance {
+    glm::mat4 model;
+    glm::vec4 minPoint;
+    glm::vec4 maxPoint;
+    unsigned int indexCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int bucket;
+};
+
+// Meshes sharing a material are drawn by one multi-draw, commands for bucket i
+// live in [firstCommand, firstCommand + maxCommands)
+struct MaterialBucket {
+    unsigned int modelIndex;
+    unsigned int materialIndex;
+    unsigned int firstCommand;
+    unsigned int maxCommands;
+
+    // Bone matrices are set per mesh, so a skinned mesh gets a bucket of its own
+    bool skinned;
+    unsigned int meshIndex;
+};
+
+// Reference implementation of culling/cull.glsl, usable without a GL context
+void cullInstances(const std::vector<GPUInstance>& instances, const glm::vec4 planes[6],
+    const std::vector<unsigned int>& bucketOffsets, std::vector<DrawElementsIndirectCommand>& commands,
+    std::vector<unsigned int>& drawCounts);
+
+class GPUCulling {
+public:
+    void init();
+
+    // Merges every mesh into one vertex/index buffer and lays out the command buffer.
+    // Meshes sharing a geometry share their range of the merged buffer. bucketKeys has one
+    // entry per scene mesh, meshes with equal keys share a bucket and so one multi-draw.
+    // Skinned meshes always get a bucket of their own.
+    void build(std::vector<Model>& models, const std::vector<MeshRef>& sceneMeshes,
+        const std::vector<unsigned int>& bucketKeys, unsigned int version);
+    void updateInstance(unsigned int index, const Model& model, const Mesh& mesh);
+
+    // Writes the surviving draws into commandBuffer and their number into countBuffer.
+    // With occlusion enabled, meshes hidden in last frame's depth pyramid are held back.
+    void cull(const Frustum& frustum);
+
+    // Second pass: re-tests what cull() held back against the pyramid of this frame,
+    // catching disoccluded meshes. Its draws live in the second half of the buffers.
+    void cullOccluded();
+
+    // Writes one command per batch of meshes already culled on the CPU into the first pass,
+    // keeping the queue's order within each bucket. Counts are known up front, so no cull
+    // dispatch is needed. A batch goes to the bucket of its first item.
+    void submit(const std::vector<RenderItem>& items, const std::vector<DrawBatch>& batches);
+
+    // Draws in a bucket when the counts were produced on the CPU, -1 when only the GPU knows
+    int getDrawCount(int pass, unsigned int bucket) const;
+    unsigned int getTriangleCount(int pass, unsigned int bucket) const;
+
+    // Where drawIndirect reads this frame's commands from: commandBuffer after a cull
+    // dispatch, commandStream when they were built on the CPU
+    unsigned int getIndirectBuffer() const { return indirectBuffer; }
+    size_t getIndirectOffset() const { return indirectOffset; }
+    size_t getStreamSize() const { return sizeof(DrawElementsIndirectCommand) * cpuCommands.size(); }
+
+    // Starts recompiling the pipelines reading any of the changed files and swaps in the
+    // ones that finished, looking their uniforms up again. Call between frames.
+    void reloadShaders(const std::vector<std::string>& changedFiles);
+
+    // Max-reduces depthTexture into a mip chain, viewProj is what the depth was rendered with
+    void buildDepthPyramid(unsigned int depthTexture, int width, int height, const glm::mat4& viewProj);
+
+    AllocatedBuffer geometry = {};
+    unsigned int instanceBuffer = 0, commandBuffer = 0, countBuffer = 0;
+    unsigned int commandsPerPass = 0;
+
+    // CPU-built commands are copied here instead of uploaded into commandBuffer
+    StreamRing* commandStream = nullptr;
+
+    std::vector<GPUInstance> instances;
+    std::vector<MaterialBucket> buckets;
+
+    unsigned int sceneVersion = 0;
+    bool useCPUFallback = false;
+    bool useOcclusion = false;
+
+    unsigned int depthPyramid = 0;
+    int pyramidWidth = 0, pyramidHeight = 0, pyramidLevels = 0;
+
+private:
+    ComputeShader cullPipeline, pyramidPipeline;
+
+    struct CullUniforms {
+        UniformHandle frustumPlanes, instanceCount, cullPass, commandBase, countBase;
+        UniformHandle useOcclusion, depthPyramid, pyramidViewProj, pyramidSize, pyramidLevels;
+    } cullUniforms;
+
+    struct PyramidUniforms {
+        UniformHandle inputDepth, inputLevel;
+    } pyramidUniforms;
+    unsigned int bucketOffsetBuffer = 0, occlusionBuffer = 0;
+
+    glm::mat4 pyramidViewProj = glm::mat4(1.0f);
+    bool hasPyramid = false;
+
+    std::vector<unsigned int> bucketOffsets;
+    std::vector<DrawElementsIndirectCommand> cpuCommands;
+    std::vector<unsigned int> cpuDrawCounts;
+    std::vector<unsigned int> cpuTriangleCounts;
+    bool countsOnCPU = false;
+
+    unsigned int indirectBuffer = 0;
+    size_t indirectOffset = 0;
+
+    void lookupUniforms();
+    void releaseBuffers();
+    void uploadCPUCommands();
+    void dispatchCull(int pass);
+};
\ No newline at end of file
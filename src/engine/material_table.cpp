@@ -0,0 +1,149 @@
+#include "material_table.h"
+#include "utils/gl_extensions.h"
+#include "utils/gl_state.h"
+
+#include <algorithm>
+#include <iostream>
+
+void MaterialTable::init(bool allowBindless) {
+    bindless = allowBindless && glext::ARB_bindless_texture;
+    dirty = true;
+
+    if (!bindless) {
+        glCreateFramebuffers(1, &readFramebuffer);
+        glCreateFramebuffers(1, &drawFramebuffer);
+    }
+}
+
+unsigned int MaterialTable::addMaterial(unsigned int albedoTexture, unsigned int normalTexture) {
+    engineMaterials.push_back({ albedoTexture, normalTexture });
+    dirty = true;
+    return static_cast<unsigned int>(engineMaterials.size() - 1);
+}
+
+void MaterialTable::build(std::vector<Model>& models) {
+    std::vector<Source> sources = engineMaterials;
+    modelFirstMaterial.clear();
+
+    for (Model& model : models) {
+        modelFirstMaterial.push_back(static_cast<unsigned int>(sources.size()));
+
+        for (Material& material : model.materials_loaded) {
+            Source source = { 0, 0 };
+            for (Texture& texture : material.textures) {
+                if (texture.type == "texture_diffuse" && source.albedo == 0) source.albedo = texture.id;
+                if (texture.type == "texture_normal" && source.normal == 0) source.normal = texture.id;
+            }
+            sources.push_back(source);
+        }
+    }
+
+    // New textures get the next free layer, the array is only rebuilt when that grows it
+    if (!bindless) {
+        for (const Source& source : sources) {
+            for (unsigned int texture : { source.albedo, source.normal }) {
+                if (texture != 0 && layers.find(texture) == layers.end()) {
+                    unsigned int layer = static_cast<unsigned int>(layers.size());
+                    layers[texture] = layer;
+                }
+            }
+        }
+
+        if (static_cast<int>(layers.size()) != layerCount) buildTextureArray();
+    }
+
+    materials.clear();
+    for (const Source& source : sources) {
+        materials.push_back(makeMaterial(source.albedo, source.normal));
+    }
+
+    if (materials.size() > materialCapacity || materialBuffer == 0) {
+        if (materialBuffer != 0) GLState::deleteBuffers(1, &materialBuffer);
+
+        materialCapacity = std::max<size_t>(materials.size(), 1);
+        glCreateBuffers(1, &materialBuffer);
+        glNamedBufferStorage(materialBuffer, sizeof(GPUMaterial) * materialCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+    glNamedBufferSubData(materialBuffer, 0, sizeof(GPUMaterial) * materials.size(), materials.data());
+
+    dirty = false;
+}
+
+void MaterialTable::bind() const {
+    GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, materialBuffer);
+    if (!bindless) GLState::bindTextureUnit(MATERIAL_ARRAY_UNIT, textureArray);
+}
+
+GPUMaterial MaterialTable::makeMaterial(unsigned int albedo, unsigned int normal) {
+    GPUMaterial material = {};
+
+    if (albedo != 0) {
+        material.flags |= MATERIAL_HAS_ALBEDO;
+        if (bindless) material.albedoHandle = getHandle(albedo);
+        else material.albedoLayer = layers[albedo];
+    }
+    if (normal != 0) {
+        material.flags |= MATERIAL_HAS_NORMAL;
+        if (bindless) material.normalHandle = getHandle(normal);
+        else material.normalLayer = layers[normal];
+    }
+
+    return material;
+}
+
+uint64_t MaterialTable::getHandle(unsigned int texture) {
+    auto iterator = handles.find(texture);
+    if (iterator != handles.end()) return iterator->second;
+
+    // Handles freeze the sampling state, textures are never edited after loading
+    uint64_t handle = glext::glGetTextureHandleARB(texture);
+    glext::glMakeTextureHandleResidentARB(handle);
+    handles[texture] = handle;
+    return handle;
+}
+
+void MaterialTable::buildTextureArray() {
+    if (textureArray != 0) GLState::deleteTextures(1, &textureArray);
+
+    layerCount = static_cast<int>(layers.size());
+    int levels = 1;
+    while ((layerSize >> levels) > 0) levels++;
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &textureArray);
+    glTextureStorage3D(textureArray, levels, GL_RGBA8, layerSize, layerSize, std::max(layerCount, 1));
+    glTextureParameteri(textureArray, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(textureArray, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(textureArray, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(textureArray, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    for (const auto& pair : layers) {
+        copyToLayer(pair.first, pair.second);
+    }
+
+    glGenerateTextureMipmap(textureArray);
+    std::cout << "Material texture array: " << layerCount << " layers of " << layerSize << "x" << layerSize << "\n";
+}
+
+void MaterialTable::copyToLayer(unsigned int texture, unsigned int layer) {
+    int width = 0, height = 0, levels = 1;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+    // Start from the smallest mip still at least layerSize, a single linear blit
+    // from much larger sources would alias
+    int level = 0;
+    while (level + 1 < levels && (width >> 1) >= layerSize && (height >> 1) >= layerSize) {
+        width >>= 1;
+        height >>= 1;
+        level++;
+    }
+
+    glNamedFramebufferTexture(readFramebuffer, GL_COLOR_ATTACHMENT0, texture, level);
+    glNamedFramebufferReadBuffer(readFramebuffer, GL_COLOR_ATTACHMENT0);
+    glNamedFramebufferTextureLayer(drawFramebuffer, GL_COLOR_ATTACHMENT0, textureArray, 0, layer);
+    glNamedFramebufferDrawBuffer(drawFramebuffer, GL_COLOR_ATTACHMENT0);
+
+    glBlitNamedFramebuffer(readFramebuffer, drawFramebuffer, 0, 0, width, height,
+        0, 0, layerSize, layerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+}
\ No newline at end of file
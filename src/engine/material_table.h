@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/model.h"
+
+// Bindings shared with deferred/gbuffer.frag
+#define MATERIAL_BINDING 10
+#define MATERIAL_ARRAY_UNIT 8
+
+#define MATERIAL_HAS_ALBEDO (1u << 0)
+#define MATERIAL_HAS_NORMAL (1u << 1)
+
+// std430 record. Handles are resident bindless handles, layers index the shared
+// texture array when bindless is unavailable. Only one of the two is filled.
+struct GPUMaterial {
+    uint64_t albedoHandle;
+    uint64_t normalHandle;
+    unsigned int albedoLayer;
+    unsigned int normalLayer;
+    unsigned int flags;
+    unsigned int padding;
+};
+
+// Every material of the scene in one storage buffer, indexed through ObjectData::materialIndex.
+// Materials the engine owns come first, then the materials of each model in order.
+class MaterialTable {
+public:
+    // Falls back to the texture array when bindless is missing or not wanted
+    void init(bool allowBindless);
+
+    // Returns the index of an engine material, stable across rebuilds
+    unsigned int addMaterial(unsigned int albedoTexture, unsigned int normalTexture = 0);
+
+    void build(std::vector<Model>& models);
+    bool needsBuild(const std::vector<Model>& models) const { return dirty || models.size() != modelFirstMaterial.size(); }
+
+    unsigned int getIndex(unsigned int modelIndex, size_t materialIndex) const {
+        return modelFirstMaterial[modelIndex] + static_cast<unsigned int>(materialIndex);
+    }
+
+    // Binds the storage buffer and, without bindless, the texture array
+    void bind() const;
+
+    bool isBindless() const { return bindless; }
+    size_t size() const { return materials.size(); }
+    int getLayerCount() const { return layerCount; }
+
+    // Edge length of the texture array layers, sources are scaled to it
+    int layerSize = 1024;
+
+private:
+    struct Source {
+        unsigned int albedo, normal;
+    };
+
+    std::vector<Source> engineMaterials;
+    std::vector<unsigned int> modelFirstMaterial;
+    std::vector<GPUMaterial> materials;
+    bool dirty = true;
+
+    bool bindless = false;
+    std::unordered_map<unsigned int, uint64_t> handles;
+
+    unsigned int textureArray = 0;
+    int layerCount = 0;
+    std::unordered_map<unsigned int, unsigned int> layers;
+    unsigned int readFramebuffer = 0, drawFramebuffer = 0;
+
+    unsigned int materialBuffer = 0;
+    size_t materialCapacity = 0;
+
+    GPUMaterial makeMaterial(unsigned int albedo, unsigned int normal);
+    uint64_t getHandle(unsigned int texture);
+    void buildTextureArray();
+    void copyToLayer(unsigned int texture, unsigned int layer);
+};
\ No newline at end of file
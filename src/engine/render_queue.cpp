@@ -0,0 +1,49 @@
+#include "render_queue.h"
+
+#include <algorithm>
+
+uint64_t RenderQueue::makeKey(unsigned int pass, unsigned int pipeline, unsigned int material,
+    unsigned int geometry, float depth) {
+    auto field = [](uint64_t value, int bits) { return value & ((uint64_t(1) << bits) - 1); };
+
+    uint64_t depthBits = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * float((1 << SORT_DEPTH_BITS) - 1));
+
+    uint64_t key = field(pass, SORT_PASS_BITS);
+    key = (key << SORT_PIPELINE_BITS) | field(pipeline, SORT_PIPELINE_BITS);
+    key = (key << SORT_MATERIAL_BITS) | field(material, SORT_MATERIAL_BITS);
+    key = (key << SORT_GEOMETRY_BITS) | field(geometry, SORT_GEOMETRY_BITS);
+    key = (key << SORT_DEPTH_BITS) | depthBits;
+    return key;
+}
+
+void RenderQueue::sort() {
+    if (items.size() < 2) return;
+    scratch.resize(items.size());
+
+    // All histograms in one read over the keys
+    unsigned int counts[8][256] = {};
+    for (const RenderItem& item : items) {
+        for (int byte = 0; byte < 8; byte++) {
+            counts[byte][(item.key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    for (int byte = 0; byte < 8; byte++) {
+        unsigned int* count = counts[byte];
+
+        // Every key shares this byte, the pass would only copy
+        if (count[(items[0].key >> (byte * 8)) & 0xFF] == items.size()) continue;
+
+        unsigned int offset = 0;
+        for (int i = 0; i < 256; i++) {
+            unsigned int bucketSize = count[i];
+            count[i] = offset;
+            offset += bucketSize;
+        }
+
+        for (const RenderItem& item : items) {
+            scratch[count[(item.key >> (byte * 8)) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
\ No newline at end of file
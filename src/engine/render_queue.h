@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sort key layout, most significant first:
+// pass (4) | pipeline (8) | material (16) | geometry (12) | depth (24)
+// Fields are truncated to their width, which only costs ordering quality, never correctness.
+#define SORT_PASS_BITS 4
+#define SORT_PIPELINE_BITS 8
+#define SORT_MATERIAL_BITS 16
+#define SORT_GEOMETRY_BITS 12
+#define SORT_DEPTH_BITS 24
+
+struct RenderItem {
+    uint64_t key;
+    unsigned int index;
+};
+
+// Consecutive queue items submitted as one instanced draw. Single items use their own
+// object record as baseInstance, longer runs read copies packed contiguously.
+struct DrawBatch {
+    unsigned int firstItem;
+    unsigned int count;
+    unsigned int baseInstance;
+};
+
+// Draws collected for one frame and radix-sorted by key before submission
+class RenderQueue {
+public:
+    // depth is normalized to [0, 1]; opaque passes want it ascending for early-Z,
+    // blended passes should pass 1 - depth
+    static uint64_t makeKey(unsigned int pass, unsigned int pipeline, unsigned int material,
+        unsigned int geometry, float depth);
+
+    void clear() { items.clear(); }
+    void push(uint64_t key, unsigned int index) { items.push_back({ key, index }); }
+
+    // Sized up front so worker threads can fill disjoint ranges through set
+    void resize(size_t count) { items.resize(count); }
+    void set(size_t slot, uint64_t key, unsigned int index) { items[slot] = { key, index }; }
+
+    // Stable LSD radix sort, 8 bits per pass. Bytes that are equal across all keys are skipped.
+    void sort();
+
+    const std::vector<RenderItem>& getItems() const { return items; }
+    size_t size() const { return items.size(); }
+
+private:
+    std::vector<RenderItem> items, scratch;
+};
\ No newline at end of file
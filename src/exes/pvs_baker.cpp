@@ -0,0 +1,37 @@
+#include "utils/model.h"
+#include "utils/pvs.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// Offline PVS bake, needs no window or GL context.
+// Usage: pvs_baker [model] [output] [scale] [cell size]
+int main(int argc, char* argv[]) {
+    std::string modelPath = argc > 1 ? argv[1] : "../resources/objects/sponzaBasic/glTF/Sponza.gltf";
+    std::string outputPath = argc > 2 ? argv[2] : "../resources/pvs/sponza.pvs";
+    float scale = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 0.1f;
+
+    PVSBakeSettings settings;
+    if (argc > 4) settings.cellSize = static_cast<float>(std::atof(argv[4]));
+
+    bool isGLTF = modelPath.size() >= 5 && (modelPath.substr(modelPath.size() - 5) == ".gltf" || modelPath.substr(modelPath.size() - 4) == ".glb");
+
+    // Has to match the transform the application loads the model with
+    std::vector<Model> models;
+    models.push_back(Model(modelPath, isGLTF ? GLTF : OBJ));
+    models[0].setTransform(glm::scale(glm::mat4(1.0f), glm::vec3(scale)));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    PVS pvs;
+    pvs.bake(models, settings);
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (pvs.empty()) {
+        std::cout << "Nothing to bake in " << modelPath << "\n";
+        return 1;
+    }
+
+    std::cout << "Baked " << pvs.getMeshCount() << " meshes in " << seconds << "s" << "\n";
+    return pvs.save(outputPath) ? 0 : 1;
+}
\ No newline at end of file
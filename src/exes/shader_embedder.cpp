@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utils/shader_includes.h"
+
+namespace fs = std::filesystem;
+
+// Build step of gl_tools, writes every shader under a directory into a source file as
+// EmbeddedShader records (see utils/embedded_shaders.h). Needs no GL context.
+// Usage: shader_embedder [shader directory] [output]
+
+namespace {
+    fs::path root;
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(root / path, std::ios::binary);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
+    }
+
+    uint64_t hashText(const std::string& text) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : text) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Raw string literals, split well below MSVC's 16 KB limit per literal
+    void writeLiteral(std::ostream& out, const std::string& text) {
+        const size_t chunkSize = 8192;
+        if (text.empty()) out << "\"\"";
+        for (size_t offset = 0; offset < text.size(); offset += chunkSize) {
+            out << "R\"glsl(" << text.substr(offset, chunkSize) << ")glsl\"\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    root = argc > 1 ? argv[1] : "../shaders/";
+    std::string outputPath = argc > 2 ? argv[2] : "embedded_shaders.cpp";
+
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(root, error), end; it != end; it.increment(error)) {
+        if (it->is_regular_file()) paths.push_back(fs::relative(it->path(), root).generic_string());
+    }
+
+    // findEmbeddedShader does a binary search
+    std::sort(paths.begin(), paths.end());
+
+    std::ostringstream out;
+    out << "// Generated by shader_embedder from " << root.generic_string() << ", do not edit\n";
+    out << "#include \"utils/embedded_shaders.h\"\n\n";
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string source;
+        std::vector<std::string> files;
+        expandShaderIncludes(paths[i], "", source, files, readFile);
+
+        out << "static const char source" << i << "[] =\n";
+        writeLiteral(out, source);
+        out << ";\n";
+        out << "static const std::string_view files" << i << "[] = {";
+        for (const std::string& file : files) out << " \"" << file << "\",";
+        out << " };\n";
+        out << "static const uint64_t hash" << i << " = " << hashText(source) << "ull;\n\n";
+    }
+
+    out << "const EmbeddedShader embeddedShaders[] = {\n";
+    for (size_t i = 0; i < paths.size(); i++) {
+        out << "    { \"" << paths[i] << "\", { source" << i << ", sizeof(source" << i << ") - 1 }, hash" << i
+            << ", files" << i << ", " << "sizeof(files" << i << ") / sizeof(files" << i << "[0]) },\n";
+    }
+    if (paths.empty()) out << "    { \"\", \"\", 0, nullptr, 0 },\n";
+    out << "};\n";
+    out << "const unsigned int embeddedShaderCount = " << paths.size() << ";";
+
+    std::ofstream file(outputPath, std::ios::binary);
+    if (!file) {
+        std::cout << "Could not write " << outputPath << "\n";
+        return 1;
+    }
+    file << out.str();
+    std::cout << "Embedded " << paths.size() << " shaders" << "\n";
+    return 0;
+}
\ No newline at end of file
@@ -57,9 +57,11 @@ void SceneEditor::render(Camera& camera)
 	if (ImGui::BeginTabItem("Camera Options")) {
 		ImGui::SliderFloat("z Near", &camera.zNear, -50.0f, 100.0f);
 		ImGui::SliderFloat("z Far", &camera.zFar, 50.0f, 1000.0f);
+		ImGui::EndTabItem();
 	}
 
 	if (ImGui::BeginTabItem("Stats")) {
+		renderStats();
 		ImGui::EndTabItem();
 	}
 	ImGui::EndTabBar();
@@ -100,6 +102,9 @@ void SceneEditor::render(Camera& camera)
 	if (ImGui::Begin("Gizmo")) {
 		if (chosenObj != nullptr) {
 			bool used = UI::manipulateMatrix(chosenObj->model_matrix, camera);
+			if (used && chosenModel != nullptr) {
+				chosenModel->markMeshDirty(*chosenObj);
+			}
 		}
 	}
 	ImGui::End();
@@ -111,6 +116,69 @@ void SceneEditor::renderDebug(Camera& camera)
 {
 }
 
+void SceneEditor::renderStats()
+{
+	if (renderer == nullptr) return;
+
+	const RenderStats& stats = renderer->getStats();
+	const FrameStats& frame = stats.getFrame();
+
+	for (int i = 0; i < METRIC_COUNT; i++) {
+		StatsMetric metric = (StatsMetric)i;
+		const std::vector<float>& history = stats.getHistory(metric);
+		float latest = history[(stats.getHistoryOffset() + RenderStats::HISTORY_SIZE - 1) % RenderStats::HISTORY_SIZE];
+
+		// Draws sized on the GPU never reach these counters
+		char overlay[32];
+		if ((metric == METRIC_TRIANGLES || metric == METRIC_INSTANCES) && frame.total.gpuCounted) snprintf(overlay, sizeof(overlay), "n/a");
+		else snprintf(overlay, sizeof(overlay), metric == METRIC_FRAME_TIME ? "%.2f" : "%.0f", latest);
+
+		ImGui::PlotLines(RenderStats::getMetricName(metric), history.data(), RenderStats::HISTORY_SIZE,
+			stats.getHistoryOffset(), overlay, 0.0f, stats.getHistoryMax(metric) * 1.1f + 1.0f, ImVec2(0, 40));
+	}
+
+	if (ImGui::CollapsingHeader("Passes", ImGuiTreeNodeFlags_DefaultOpen)
+		&& ImGui::BeginTable("passes", 11, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		const char* columns[11] = { "Pass", "Draws", "Triangles", "Dispatches", "Programs", "VAOs", "Textures",
+			"FBOs", "Buffers", "Redundant", "Uniforms" };
+		for (const char* column : columns) ImGui::TableSetupColumn(column);
+		ImGui::TableHeadersRow();
+
+		auto passRow = [](const PassStats& pass, const char* name) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", name);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.drawCalls);
+			ImGui::TableNextColumn();
+			if (pass.gpuCounted) ImGui::Text("n/a");
+			else ImGui::Text("%u", pass.triangles);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.dispatches);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.programBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.vaoBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.textureBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.framebufferBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.bufferBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.redundantBinds);
+			ImGui::TableNextColumn(); ImGui::Text("%u", pass.uniformUploads);
+		};
+
+		for (const PassStats& pass : frame.passes) {
+			passRow(pass, pass.name.c_str());
+		}
+		passRow(frame.total, "Total");
+		ImGui::EndTable();
+	}
+
+	if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen)) {
+		for (int i = 0; i < CULL_STAGE_COUNT; i++) {
+			const CullStats& stage = frame.culling[i];
+			if (stage.tested == 0) continue;
+
+			if (stage.culledUnknown) ImGui::Text("%s: n/a / %u culled (counted on the GPU)", RenderStats::getStageName((CullStage)i), stage.tested);
+			else ImGui::Text("%s: %u / %u culled", RenderStats::getStageName((CullStage)i), stage.culled, stage.tested);
+		}
+	}
+}
+
 void SceneEditor::renderAsList(Model& model) {
 	ImVec4 color(0.8f, 0.8f, 0.8f, 1.0f);
 
@@ -129,6 +197,7 @@ void SceneEditor::renderAsList(Model& model) {
 			std::string itemId = "##" + std::to_string(i);
 
 			if (ImGui::Selectable(itemId.c_str(), isSelected)) {
+				chosenModel = &model;
 				chosenObj = &model.meshes.at(i);
 				chosenMaterial = &model.materials_loaded[chosenObj->materialIndex];
 			}
@@ -145,4 +214,4 @@ void SceneEditor::renderAsList(Model& model) {
 
 	ImGui::PopStyleColor();
 	
-}
+}
\ No newline at end of file
@@ -17,9 +17,11 @@ public:
 	void render(Camera& camera);
 	void renderAsList(Model& model);
 	void renderDebug(Camera& camera);
+	void renderStats();
 
 	GLEngine* renderer = nullptr;
 	std::vector<Model> *objs = nullptr;
+	Model* chosenModel = nullptr;
 	Mesh* chosenObj = nullptr;
 	Material* chosenMaterial = nullptr;
 
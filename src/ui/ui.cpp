@@ -1,4 +1,5 @@
 #include "ui.h"
+#include "utils/gl_state.h"
 
 namespace UI {
     Texture icons;
@@ -26,7 +27,7 @@ namespace UI {
         ImVec2 uv0(x / 16.0f, x / 16.0f);
         ImVec2 uv1(uv0.x + 1.0f / 16.0f, uv0.y + 1.0f / 16.0f);
 
-        glBindTextureUnit(0, icons.id);
+        GLState::bindTextureUnit(0, icons.id);
         glTextureParameteri(icons.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         ImGui::Image((void*)icons.id, ImVec2(size / aspect, size), uv0, uv1, color);
     }
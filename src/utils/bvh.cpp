@@ -0,0 +1,363 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    const int SAH_BINS = 8;
+    const unsigned int MAX_LEAF_ITEMS = 4;
+    const int MAX_STACK_DEPTH = 64;
+    const int MAX_RAY_STACK_DEPTH = 256;
+
+    float surfaceArea(const glm::vec3& minPoint, const glm::vec3& maxPoint) {
+        glm::vec3 extent = glm::max(maxPoint - minPoint, glm::vec3(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // Entry distance of a ray into a box, FLT_MAX when it misses or enters past maxDistance
+    float intersectBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+        const glm::vec3& minPoint, const glm::vec3& maxPoint) {
+        glm::vec3 t0 = (minPoint - origin) * inverseDirection;
+        glm::vec3 t1 = (maxPoint - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return entry <= exit ? entry : FLT_MAX;
+    }
+
+    struct Bin {
+        glm::vec3 minPoint = glm::vec3(FLT_MAX);
+        glm::vec3 maxPoint = glm::vec3(-FLT_MAX);
+        unsigned int count = 0;
+    };
+}
+
+void BVH::build(const std::vector<BoundingBox>& bounds) {
+    unsigned int itemCount = static_cast<unsigned int>(bounds.size());
+
+    nodes.clear();
+    itemIndices.resize(itemCount);
+    itemToLeaf.resize(itemCount);
+    itemMin.resize(itemCount);
+    itemMax.resize(itemCount);
+    if (itemCount == 0) return;
+
+    std::vector<glm::vec3> centroids(itemCount);
+    for (unsigned int i = 0; i < itemCount; i++) {
+        itemIndices[i] = i;
+        itemMin[i] = glm::vec3(bounds[i].minPoint);
+        itemMax[i] = glm::vec3(bounds[i].maxPoint);
+        centroids[i] = (itemMin[i] + itemMax[i]) * 0.5f;
+    }
+
+    nodes.resize(itemCount * 2 - 1);
+    parents.assign(itemCount * 2 - 1, 0);
+    nodesUsed = 1;
+
+    BVHNode& root = nodes[0];
+    root.leftFirst = 0;
+    root.count = itemCount;
+    updateNodeBounds(0);
+    subdivide(0, centroids);
+
+    nodes.resize(nodesUsed);
+    parents.resize(nodesUsed);
+
+    for (unsigned int i = 0; i < nodesUsed; i++) {
+        const BVHNode& node = nodes[i];
+        if (!node.isLeaf()) continue;
+
+        for (unsigned int j = 0; j < node.count; j++) {
+            itemToLeaf[itemIndices[node.leftFirst + j]] = i;
+        }
+    }
+}
+
+void BVH::updateNodeBounds(unsigned int nodeIndex) {
+    BVHNode& node = nodes[nodeIndex];
+    node.minPoint = glm::vec3(FLT_MAX);
+    node.maxPoint = glm::vec3(-FLT_MAX);
+
+    for (unsigned int i = 0; i < node.count; i++) {
+        unsigned int item = itemIndices[node.leftFirst + i];
+        node.minPoint = glm::min(node.minPoint, itemMin[item]);
+        node.maxPoint = glm::max(node.maxPoint, itemMax[item]);
+    }
+}
+
+void BVH::subdivide(unsigned int nodeIndex, std::vector<glm::vec3>& centroids) {
+    BVHNode& node = nodes[nodeIndex];
+    if (node.count <= 1) return;
+
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    for (unsigned int i = 0; i < node.count; i++) {
+        const glm::vec3& centroid = centroids[itemIndices[node.leftFirst + i]];
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = centroidMax[axis] - centroidMin[axis];
+        if (extent <= 0.0f) continue;
+
+        Bin bins[SAH_BINS];
+        float scale = SAH_BINS / extent;
+        for (unsigned int i = 0; i < node.count; i++) {
+            unsigned int item = itemIndices[node.leftFirst + i];
+            int binIndex = std::min(SAH_BINS - 1, (int)((centroids[item][axis] - centroidMin[axis]) * scale));
+
+            bins[binIndex].count++;
+            bins[binIndex].minPoint = glm::min(bins[binIndex].minPoint, itemMin[item]);
+            bins[binIndex].maxPoint = glm::max(bins[binIndex].maxPoint, itemMax[item]);
+        }
+
+        // Sweep from both sides so every split plane is evaluated in O(bins)
+        float leftArea[SAH_BINS - 1], rightArea[SAH_BINS - 1];
+        unsigned int leftCount[SAH_BINS - 1], rightCount[SAH_BINS - 1];
+        Bin leftBox, rightBox;
+        unsigned int leftSum = 0, rightSum = 0;
+        for (int i = 0; i < SAH_BINS - 1; i++) {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+            leftBox.minPoint = glm::min(leftBox.minPoint, bins[i].minPoint);
+            leftBox.maxPoint = glm::max(leftBox.maxPoint, bins[i].maxPoint);
+            leftArea[i] = surfaceArea(leftBox.minPoint, leftBox.maxPoint);
+
+            rightSum += bins[SAH_BINS - 1 - i].count;
+            rightCount[SAH_BINS - 2 - i] = rightSum;
+            rightBox.minPoint = glm::min(rightBox.minPoint, bins[SAH_BINS - 1 - i].minPoint);
+            rightBox.maxPoint = glm::max(rightBox.maxPoint, bins[SAH_BINS - 1 - i].maxPoint);
+            rightArea[SAH_BINS - 2 - i] = surfaceArea(rightBox.minPoint, rightBox.maxPoint);
+        }
+
+        for (int i = 0; i < SAH_BINS - 1; i++) {
+            if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    // All centroids coincide, nothing left to split on
+    if (bestAxis == -1) return;
+
+    float leafCost = node.count * surfaceArea(node.minPoint, node.maxPoint);
+    if (bestCost >= leafCost && node.count <= MAX_LEAF_ITEMS) return;
+
+    float scale = SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+    int i = node.leftFirst;
+    int j = i + node.count - 1;
+    while (i <= j) {
+        unsigned int item = itemIndices[i];
+        int binIndex = std::min(SAH_BINS - 1, (int)((centroids[item][bestAxis] - centroidMin[bestAxis]) * scale));
+
+        if (binIndex <= bestSplit) i++;
+        else std::swap(itemIndices[i], itemIndices[j--]);
+    }
+
+    unsigned int leftCount = i - node.leftFirst;
+    if (leftCount == 0 || leftCount == node.count) return;
+
+    unsigned int leftChild = nodesUsed++;
+    unsigned int rightChild = nodesUsed++;
+
+    nodes[leftChild].leftFirst = node.leftFirst;
+    nodes[leftChild].count = leftCount;
+    nodes[rightChild].leftFirst = i;
+    nodes[rightChild].count = node.count - leftCount;
+    parents[leftChild] = nodeIndex;
+    parents[rightChild] = nodeIndex;
+
+    node.leftFirst = leftChild;
+    node.count = 0;
+
+    updateNodeBounds(leftChild);
+    updateNodeBounds(rightChild);
+    subdivide(leftChild, centroids);
+    subdivide(rightChild, centroids);
+}
+
+void BVH::refit(unsigned int item, const BoundingBox& box) {
+    itemMin[item] = glm::vec3(box.minPoint);
+    itemMax[item] = glm::vec3(box.maxPoint);
+
+    unsigned int nodeIndex = itemToLeaf[item];
+    updateNodeBounds(nodeIndex);
+
+    while (nodeIndex != 0) {
+        nodeIndex = parents[nodeIndex];
+        BVHNode& node = nodes[nodeIndex];
+        const BVHNode& left = nodes[node.leftFirst];
+        const BVHNode& right = nodes[node.leftFirst + 1];
+
+        glm::vec3 newMin = glm::min(left.minPoint, right.minPoint);
+        glm::vec3 newMax = glm::max(left.maxPoint, right.maxPoint);
+        if (newMin == node.minPoint && newMax == node.maxPoint) break;
+
+        node.minPoint = newMin;
+        node.maxPoint = newMax;
+    }
+}
+
+void BVH::refitAll(const std::vector<BoundingBox>& bounds) {
+    for (unsigned int i = 0; i < itemMin.size(); i++) {
+        itemMin[i] = glm::vec3(bounds[i].minPoint);
+        itemMax[i] = glm::vec3(bounds[i].maxPoint);
+    }
+
+    // Children are always allocated after their parent, so a reverse sweep is bottom-up
+    for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; i--) {
+        BVHNode& node = nodes[i];
+        if (node.isLeaf()) {
+            updateNodeBounds(i);
+        }
+        else {
+            node.minPoint = glm::min(nodes[node.leftFirst].minPoint, nodes[node.leftFirst + 1].minPoint);
+            node.maxPoint = glm::max(nodes[node.leftFirst].maxPoint, nodes[node.leftFirst + 1].maxPoint);
+        }
+    }
+}
+
+void BVH::emitSubtree(unsigned int nodeIndex, std::vector<unsigned int>& visibleItems) const {
+    // Items of a subtree are contiguous in itemIndices, so only the outermost leaves matter
+    unsigned int first = nodeIndex, last = nodeIndex;
+    while (!nodes[first].isLeaf()) first = nodes[first].leftFirst;
+    while (!nodes[last].isLeaf()) last = nodes[last].leftFirst + 1;
+
+    unsigned int begin = nodes[first].leftFirst;
+    unsigned int end = nodes[last].leftFirst + nodes[last].count;
+    visibleItems.insert(visibleItems.end(), itemIndices.begin() + begin, itemIndices.begin() + end);
+}
+
+void BVH::cull(const Frustum& frustum, std::vector<unsigned int>& visibleItems, unsigned int root) const {
+    if (nodes.empty()) return;
+
+    unsigned int stack[MAX_STACK_DEPTH];
+    unsigned int maskStack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+
+    stack[stackSize] = root;
+    maskStack[stackSize++] = (1u << frustum.allPlanes.size()) - 1;
+
+    while (stackSize > 0) {
+        stackSize--;
+        unsigned int nodeIndex = stack[stackSize];
+        unsigned int planeMask = maskStack[stackSize];
+        const BVHNode& node = nodes[nodeIndex];
+
+        FrustumResult result = frustum.classify(node.minPoint, node.maxPoint, planeMask);
+        if (result == OUTSIDE) continue;
+
+        if (result == INSIDE || stackSize + 2 > MAX_STACK_DEPTH) {
+            emitSubtree(nodeIndex, visibleItems);
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (unsigned int i = 0; i < node.count; i++) {
+                unsigned int item = itemIndices[node.leftFirst + i];
+                unsigned int itemMask = planeMask;
+                if (node.count == 1 || frustum.classify(itemMin[item], itemMax[item], itemMask) != OUTSIDE) {
+                    visibleItems.push_back(item);
+                }
+            }
+            continue;
+        }
+
+        stack[stackSize] = node.leftFirst + 1;
+        maskStack[stackSize++] = planeMask;
+        stack[stackSize] = node.leftFirst;
+        maskStack[stackSize++] = planeMask;
+    }
+}
+
+void BVH::getSubtrees(unsigned int count, std::vector<unsigned int>& roots) const {
+    roots.clear();
+    if (nodes.empty()) return;
+
+    roots.push_back(0);
+    std::vector<unsigned int> next;
+    while (roots.size() < count) {
+        next.clear();
+        for (unsigned int nodeIndex : roots) {
+            const BVHNode& node = nodes[nodeIndex];
+            if (node.isLeaf()) {
+                next.push_back(nodeIndex);
+            }
+            else {
+                next.push_back(node.leftFirst);
+                next.push_back(node.leftFirst + 1);
+            }
+        }
+
+        if (next.size() == roots.size()) break;
+        roots.swap(next);
+    }
+}
+
+int BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+    const std::function<float(unsigned int)>& intersectItem, float& hitDistance) const {
+    hitDistance = maxDistance;
+    if (nodes.empty()) return -1;
+
+    glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+    int hitItem = -1;
+
+    // Dropping a node would make the PVS baker miss hits, so deep trees spill the
+    // fixed stack into a vector instead
+    unsigned int fixedStack[MAX_RAY_STACK_DEPTH];
+    std::vector<unsigned int> grownStack;
+    unsigned int* stack = fixedStack;
+    size_t stackCapacity = MAX_RAY_STACK_DEPTH;
+    size_t stackSize = 0;
+    auto push = [&](unsigned int nodeIndex) {
+        if (stackSize == stackCapacity) {
+            if (grownStack.empty()) grownStack.assign(fixedStack, fixedStack + stackSize);
+            stackCapacity *= 2;
+            grownStack.resize(stackCapacity);
+            stack = grownStack.data();
+        }
+        stack[stackSize++] = nodeIndex;
+    };
+
+    if (intersectBox(origin, inverseDirection, hitDistance, nodes[0].minPoint, nodes[0].maxPoint) != FLT_MAX) {
+        push(0);
+    }
+
+    while (stackSize > 0) {
+        const BVHNode& node = nodes[stack[--stackSize]];
+
+        if (node.isLeaf()) {
+            for (unsigned int i = 0; i < node.count; i++) {
+                unsigned int item = itemIndices[node.leftFirst + i];
+                float distance = intersectItem(item);
+                if (distance >= 0.0f && distance < hitDistance) {
+                    hitDistance = distance;
+                    hitItem = static_cast<int>(item);
+                }
+            }
+            continue;
+        }
+
+        unsigned int nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+        float nearDistance = intersectBox(origin, inverseDirection, hitDistance, nodes[nearChild].minPoint, nodes[nearChild].maxPoint);
+        float farDistance = intersectBox(origin, inverseDirection, hitDistance, nodes[farChild].minPoint, nodes[farChild].maxPoint);
+        if (farDistance < nearDistance) {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+
+        // Pushed far first so the near child is popped next
+        if (farDistance != FLT_MAX) push(farChild);
+        if (nearDistance != FLT_MAX) push(nearChild);
+    }
+
+    return hitItem;
+}
\ No newline at end of file
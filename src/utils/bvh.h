@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+#include "utils/types.h"
+#include "utils/camera.h"
+
+// 32 byte node. Inner nodes store the index of their left child in leftFirst
+// (the right child follows it), leaves store the first entry of itemIndices.
+struct BVHNode {
+    glm::vec3 minPoint;
+    unsigned int leftFirst;
+    glm::vec3 maxPoint;
+    unsigned int count;
+
+    bool isLeaf() const { return count > 0; }
+};
+
+class BVH {
+public:
+    // Binned SAH build over arbitrary item bounds, items are referred to by their
+    // index in the bounds vector
+    void build(const std::vector<BoundingBox>& bounds);
+
+    // Updates one item and walks up to the root, stopping once bounds stop changing
+    void refit(unsigned int item, const BoundingBox& box);
+    void refitAll(const std::vector<BoundingBox>& bounds);
+
+    // Appends every item whose bounds touch the frustum. Subtrees fully inside are
+    // accepted without testing their children.
+    void cull(const Frustum& frustum, std::vector<unsigned int>& visibleItems, unsigned int root = 0) const;
+
+    // Disjoint subtrees covering the whole tree, at least count of them unless it runs out of
+    // inner nodes. Culling each in order gives the same items, in the same order, as cull.
+    void getSubtrees(unsigned int count, std::vector<unsigned int>& roots) const;
+
+    // Closest hit along a ray, visiting nearer children first. intersectItem returns the
+    // distance to an item or a negative value on a miss. Returns the hit item or -1.
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+        const std::function<float(unsigned int)>& intersectItem, float& hitDistance) const;
+
+    size_t size() const { return itemMin.size(); }
+    bool empty() const { return itemMin.empty(); }
+
+    std::vector<BVHNode> nodes;
+
+private:
+    std::vector<unsigned int> itemIndices;
+    std::vector<unsigned int> itemToLeaf;
+    std::vector<unsigned int> parents;
+    std::vector<glm::vec3> itemMin, itemMax;
+
+    unsigned int nodesUsed = 0;
+
+    void subdivide(unsigned int nodeIndex, std::vector<glm::vec3>& centroids);
+    void updateNodeBounds(unsigned int nodeIndex);
+    void emitSubtree(unsigned int nodeIndex, std::vector<unsigned int>& visibleItems) const;
+};
\ No newline at end of file
@@ -128,17 +128,31 @@ bool Camera::isInsideFrustum(glm::vec4& maxPoint, glm::vec4& minPoint) {
     return frustum.isInside(maxPoint, minPoint);
 }
 
+bool Camera::isInsideFrustum(const BoundingBox& box) {
+    if (shouldUseRadar) {
+        glm::vec4 maxPoint = box.maxPoint, minPoint = box.minPoint;
+        return radarInsideFrustum(maxPoint, minPoint);
+    }
+
+    return frustum.isInside(box);
+}
+
 bool Frustum::isInside(glm::vec4& maxPoint, glm::vec4& minPoint) {
-    for (FrustumPlane& plane : allPlanes) {
-        glm::vec3 positive(minPoint.x, minPoint.y, minPoint.z);
-        if (plane.normal.x > 0.0f) positive.x = maxPoint.x;
-        if (plane.normal.y > 0.0f) positive.y = maxPoint.y;
-        if (plane.normal.z > 0.0f) positive.z = maxPoint.z;
+    BoundingBox box;
+    box.minPoint = minPoint;
+    box.maxPoint = maxPoint;
+
+    return isInside(box);
+}
 
-        glm::vec3 negative(maxPoint.x, maxPoint.y, maxPoint.z);
-        if (plane.normal.x < 0.0f) negative.x = minPoint.x;
-        if (plane.normal.y < 0.0f) negative.y = minPoint.y;
-        if (plane.normal.z < 0.0f) negative.z = minPoint.z;
+bool Frustum::isInside(const BoundingBox& box) const {
+    for (const FrustumPlane& plane : allPlanes) {
+        // Only the corner furthest along the normal matters; a box that merely
+        // straddles a plane is still visible
+        glm::vec3 positive(box.minPoint.x, box.minPoint.y, box.minPoint.z);
+        if (plane.normal.x > 0.0f) positive.x = box.maxPoint.x;
+        if (plane.normal.y > 0.0f) positive.y = box.maxPoint.y;
+        if (plane.normal.z > 0.0f) positive.z = box.maxPoint.z;
 
         glm::vec3 direction = positive - plane.point;
         float distance = glm::dot(plane.normal, direction);
@@ -146,13 +160,37 @@ bool Frustum::isInside(glm::vec4& maxPoint, glm::vec4& minPoint) {
         if (distance < 0.0f) {
             return false;
         }
-
-        direction = negative - plane.point;
-        distance = glm::dot(plane.normal, direction);
-        if (distance < 0.0f) {
-            return false;
-        }
     }
 
     return true;
+}
+
+FrustumResult Frustum::classify(const glm::vec3& minPoint, const glm::vec3& maxPoint, unsigned int& planeMask) const {
+    for (unsigned int i = 0; i < allPlanes.size(); i++) {
+        unsigned int bit = 1u << i;
+        if ((planeMask & bit) == 0) continue;
+
+        const FrustumPlane& plane = allPlanes[i];
+        glm::vec3 positive = minPoint, negative = maxPoint;
+        if (plane.normal.x > 0.0f) { positive.x = maxPoint.x; negative.x = minPoint.x; }
+        if (plane.normal.y > 0.0f) { positive.y = maxPoint.y; negative.y = minPoint.y; }
+        if (plane.normal.z > 0.0f) { positive.z = maxPoint.z; negative.z = minPoint.z; }
+
+        if (glm::dot(plane.normal, positive - plane.point) < 0.0f) return OUTSIDE;
+        if (glm::dot(plane.normal, negative - plane.point) >= 0.0f) planeMask &= ~bit;
+    }
+
+    return planeMask == 0 ? INSIDE : INTERSECTING;
+}
+
+void Frustum::getPlanes(glm::vec4 planes[6]) const {
+    for (unsigned int i = 0; i < 6; i++) {
+        if (i >= allPlanes.size()) {
+            planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            continue;
+        }
+
+        const FrustumPlane& plane = allPlanes[i];
+        planes[i] = glm::vec4(plane.normal, -glm::dot(plane.normal, plane.point));
+    }
 }
\ No newline at end of file
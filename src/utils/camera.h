@@ -13,10 +13,22 @@ struct FrustumPlane {
     glm::vec3 normal;
 };
 
+enum FrustumResult {
+    OUTSIDE = 0, INTERSECTING, INSIDE
+};
+
 struct Frustum {
     std::vector<FrustumPlane> allPlanes;
 
     bool isInside(glm::vec4& maxPoint, glm::vec4& minPoint);
+    bool isInside(const BoundingBox& box) const;
+
+    // planeMask holds one bit per plane still worth testing; planes the box is
+    // fully in front of are cleared so children of a BVH node can skip them
+    FrustumResult classify(const glm::vec3& minPoint, const glm::vec3& maxPoint, unsigned int& planeMask) const;
+
+    // Planes as (normal, distance) so they can be uploaded to shaders
+    void getPlanes(glm::vec4 planes[6]) const;
 };
 
 enum ProjectionType {
@@ -82,6 +94,7 @@ public:
     void processMouseScroll(float yoffset);
 
     bool isInsideFrustum(glm::vec4& maxPoint, glm::vec4& minPoint);
+    bool isInsideFrustum(const BoundingBox& box);
     bool radarInsideFrustum(glm::vec4& maxPoint, glm::vec4& minPoint);
 
 private:
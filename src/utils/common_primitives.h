@@ -2,6 +2,7 @@
 
 #include "utils/shader.h"
 #include "utils/functions.h"
+#include "utils/gl_state.h"
 
 namespace glutil {
     AllocatedBuffer createUnitCube();
@@ -30,11 +31,10 @@ struct EnviornmentCubemap {
         pipeline.setMat4("projection", projection);
         pipeline.setMat4("view", convertedView);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        GLState::bindTextureUnit(0, texture);
         pipeline.setInt("skybox", 0);
 
-        glBindVertexArray(buffer.VAO);
+        GLState::bindVertexArray(buffer.VAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glDepthFunc(GL_LESS);
     }
@@ -50,7 +50,7 @@ struct ScreenQuad {
     }
 
     void draw() {
-        glBindVertexArray(buffer.VAO);
+        GLState::bindVertexArray(buffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     }
 };
\ No newline at end of file
@@ -1,126 +1,132 @@
 #include "compute.h"
+#include "render_stats.h"
+#include "gl_state.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
 #include <iostream>
 
 ComputeShader::ComputeShader() {}
 
-ComputeShader::ComputeShader(std::string computePath) {
-    std::string generalPath = "../shaders/";
-    std::string fullPath = generalPath + computePath;
-    std::string computeCode;
-    std::ifstream computeFile;
+ComputeShader::ComputeShader(std::string computePath, ShaderDefines defines) : defines(std::move(defines)) {
+    path = computePath;
+    ID = ProgramBuilder::start(loadStages(), pending);
+}
+
+std::vector<ShaderStage> ComputeShader::loadStages() {
+    ShaderStage stage = { GL_COMPUTE_SHADER, "COMPUTE", {}, 0 };
+    stage.source = ProgramBuilder::preprocess(path, defines, files, &stage.hash);
+    return { stage };
+}
 
-    computeFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        computeFile.open(fullPath);
-        std::stringstream computeStream;
+bool ComputeShader::usesFile(std::string_view file) const {
+    return std::find(files.begin(), files.end(), file) != files.end();
+}
 
-        computeStream << computeFile.rdbuf();
-        computeFile.close();
+void ComputeShader::reload() {
+    if (reloadID != 0) ProgramBuilder::cancel(reloadID, reloadPending);
+    reloadID = ProgramBuilder::start(loadStages(), reloadPending);
+}
 
-        computeCode = computeStream.str();
-    } catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
+bool ComputeShader::applyReload() {
+    if (reloadID == 0 || !ProgramBuilder::isComplete(reloadID, reloadPending)) return false;
 
-    unsigned int compute;
+    unsigned int program = reloadID;
+    reloadID = 0;
+    if (!ProgramBuilder::finish(program, reloadPending)) {
+        std::cout << "Keeping the previous program for " << path << "\n";
+        GLState::deleteProgram(program);
+        return false;
+    }
 
-    const char* cShaderCode = computeCode.c_str();
-    compute = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(compute, 1, &cShaderCode, nullptr);
-    glCompileShader(compute);
-    checkCompileErrors(compute, "COMPUTE");
+    ProgramBuilder::finish(ID, pending);
+    GLState::deleteProgram(ID);
+    ID = program;
+    uniforms.reflect(ID);
+    linked = true;
+    return true;
+}
 
-    ID = glCreateProgram();
-    glAttachShader(ID, compute);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+void ComputeShader::ensureLinked() const {
+    if (linked) return;
+    linked = true;
 
-    glDeleteShader(compute);
+    ProgramBuilder::finish(ID, pending);
+    uniforms.reflect(ID);
 }
 
 void ComputeShader::use() {
-    glUseProgram(ID);
+    ensureLinked();
+    GLState::useProgram(ID);
 }
 
-void ComputeShader::setBool(const std::string &name, bool value) const
-{         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+void ComputeShader::setBool(UniformHandle uniform, bool value) const
+{
+    glProgramUniform1i(ID, uniform.location, (int)value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setInt(const std::string &name, int value) const
-{ 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+void ComputeShader::setInt(UniformHandle uniform, int value) const
+{
+    glProgramUniform1i(ID, uniform.location, value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setFloat(const std::string &name, float value) const
-{ 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+void ComputeShader::setFloat(UniformHandle uniform, float value) const
+{
+    glProgramUniform1f(ID, uniform.location, value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setVec2(const std::string &name, const glm::vec2 &value) const
-{ 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
-}
-void ComputeShader::setVec2(const std::string &name, float x, float y) const
-{ 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+void ComputeShader::setVec2(UniformHandle uniform, const glm::vec2 &value) const
+{
+    glProgramUniform2fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setVec3(const std::string &name, const glm::vec3 &value) const
-{ 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+void ComputeShader::setVec3(UniformHandle uniform, const glm::vec3 &value) const
+{
+    glProgramUniform3fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
-void ComputeShader::setVec3(const std::string &name, float x, float y, float z) const
-{ 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+// ------------------------------------------------------------------------
+void ComputeShader::setVec4(UniformHandle uniform, const glm::vec4 &value) const
+{
+    glProgramUniform4fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setVec4(const std::string &name, const glm::vec4 &value) const
-{ 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+void ComputeShader::setMat2(UniformHandle uniform, const glm::mat2 &mat) const
+{
+    glProgramUniformMatrix2fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
-void ComputeShader::setVec4(const std::string &name, float x, float y, float z, float w) 
-{ 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+// ------------------------------------------------------------------------
+void ComputeShader::setMat3(UniformHandle uniform, const glm::mat3 &mat) const
+{
+    glProgramUniformMatrix3fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setMat2(const std::string &name, const glm::mat2 &mat) const
+void ComputeShader::setMat4(UniformHandle uniform, const glm::mat4 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glProgramUniformMatrix4fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setMat3(const std::string &name, const glm::mat3 &mat) const
+void ComputeShader::setVec3Array(UniformHandle uniform, const glm::vec3 *values, int count) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glProgramUniform3fv(ID, uniform.location, std::min(count, uniform.size), &values[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void ComputeShader::setMat4(const std::string &name, const glm::mat4 &mat) const
+void ComputeShader::setVec4Array(UniformHandle uniform, const glm::vec4 *values, int count) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glProgramUniform4fv(ID, uniform.location, std::min(count, uniform.size), &values[0][0]);
+    RenderStats::countUniformUpload();
 }
-
-void checkCompileErrors(unsigned int shader, std::string type) {
-    int success;
-    char infoLog[1024];
-    if (type != "PROGRAM")
-    {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
-    else
-    {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success)
-        {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
+// ------------------------------------------------------------------------
+void ComputeShader::setMat4Array(UniformHandle uniform, const glm::mat4 *values, int count) const
+{
+    glProgramUniformMatrix4fv(ID, uniform.location, std::min(count, uniform.size), GL_FALSE, &values[0][0][0]);
+    RenderStats::countUniformUpload();
 }
\ No newline at end of file
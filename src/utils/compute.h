@@ -1,40 +1,80 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <vector>
 #include <glad/glad.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "uniforms.h"
+#include "program_builder.h"
 
 class ComputeShader {
     public:
-        unsigned int ID;
+        unsigned int ID = 0;
 
         ComputeShader();
-        ComputeShader(std::string computePath);
+        ComputeShader(std::string computePath, ShaderDefines defines = {});
         void use();
 
-        void setBool(const std::string &name, bool value) const;
-        // ------------------------------------------------------------------------
-        void setInt(const std::string &name, int value) const;
-        // ------------------------------------------------------------------------
-        void setFloat(const std::string &name, float value) const;
-        // ------------------------------------------------------------------------
-        void setVec2(const std::string &name, const glm::vec2 &value) const;
-        void setVec2(const std::string &name, float x, float y) const;
-        // ------------------------------------------------------------------------
-        void setVec3(const std::string &name, const glm::vec3 &value) const;
-        void setVec3(const std::string &name, float x, float y, float z) const;
-        // ------------------------------------------------------------------------
-        void setVec4(const std::string &name, const glm::vec4 &value) const;
-        void setVec4(const std::string &name, float x, float y, float z, float w);
-        // ------------------------------------------------------------------------
-        void setMat2(const std::string &name, const glm::mat2 &mat) const;
-        // ------------------------------------------------------------------------
-        void setMat3(const std::string &name, const glm::mat3 &mat) const;
-        // ------------------------------------------------------------------------
-        void setMat4(const std::string &name, const glm::mat4 &mat) const;
-};
-
-void checkCompileErrors(unsigned int shader, std::string type);
\ No newline at end of file
+        // Compiles run in the background, this polls them without blocking. Everything
+        // else waits for the program the first time it is needed.
+        bool isReady() const { return ProgramBuilder::isComplete(ID, pending); }
+
+        // Hot reload, see Shader
+        bool usesFile(std::string_view file) const;
+        void reload();
+        bool applyReload();
+
+        // Handles stay valid for the lifetime of the program, look them up once
+        UniformHandle getUniform(std::string_view name) const {
+            ensureLinked();
+            return uniforms.find(name);
+        }
+
+        void setBool(UniformHandle uniform, bool value) const;
+        void setInt(UniformHandle uniform, int value) const;
+        void setFloat(UniformHandle uniform, float value) const;
+        void setVec2(UniformHandle uniform, const glm::vec2 &value) const;
+        void setVec3(UniformHandle uniform, const glm::vec3 &value) const;
+        void setVec4(UniformHandle uniform, const glm::vec4 &value) const;
+        void setMat2(UniformHandle uniform, const glm::mat2 &mat) const;
+        void setMat3(UniformHandle uniform, const glm::mat3 &mat) const;
+        void setMat4(UniformHandle uniform, const glm::mat4 &mat) const;
+        void setVec3Array(UniformHandle uniform, const glm::vec3 *values, int count) const;
+        void setVec4Array(UniformHandle uniform, const glm::vec4 *values, int count) const;
+        void setMat4Array(UniformHandle uniform, const glm::mat4 *values, int count) const;
+
+        // String versions go through the reflected cache
+        void setBool(std::string_view name, bool value) const { setBool(getUniform(name), value); }
+        void setInt(std::string_view name, int value) const { setInt(getUniform(name), value); }
+        void setFloat(std::string_view name, float value) const { setFloat(getUniform(name), value); }
+        void setVec2(std::string_view name, const glm::vec2 &value) const { setVec2(getUniform(name), value); }
+        void setVec2(std::string_view name, float x, float y) const { setVec2(getUniform(name), glm::vec2(x, y)); }
+        void setVec3(std::string_view name, const glm::vec3 &value) const { setVec3(getUniform(name), value); }
+        void setVec3(std::string_view name, float x, float y, float z) const { setVec3(getUniform(name), glm::vec3(x, y, z)); }
+        void setVec4(std::string_view name, const glm::vec4 &value) const { setVec4(getUniform(name), value); }
+        void setVec4(std::string_view name, float x, float y, float z, float w) const { setVec4(getUniform(name), glm::vec4(x, y, z, w)); }
+        void setMat2(std::string_view name, const glm::mat2 &mat) const { setMat2(getUniform(name), mat); }
+        void setMat3(std::string_view name, const glm::mat3 &mat) const { setMat3(getUniform(name), mat); }
+        void setMat4(std::string_view name, const glm::mat4 &mat) const { setMat4(getUniform(name), mat); }
+        void setVec3Array(std::string_view name, const glm::vec3 *values, int count) const { setVec3Array(getUniform(name), values, count); }
+        void setVec4Array(std::string_view name, const glm::vec4 *values, int count) const { setVec4Array(getUniform(name), values, count); }
+        void setMat4Array(std::string_view name, const glm::mat4 *values, int count) const { setMat4Array(getUniform(name), values, count); }
+
+    private:
+        mutable UniformCache uniforms;
+        mutable PendingProgram pending;
+        mutable bool linked = false;
+
+        std::string path;
+        std::vector<std::string> files;
+        ShaderDefines defines;
+        unsigned int reloadID = 0;
+        PendingProgram reloadPending;
+
+        std::vector<ShaderStage> loadStages();
+        void ensureLinked() const;
+};
\ No newline at end of file
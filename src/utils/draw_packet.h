@@ -0,0 +1,48 @@
+#pragma once
+
+// Texture kinds a material binds. Each goes to the texture unit of the same number,
+// so sampler uniforms are set once per program instead of per draw.
+enum MaterialSlot {
+    SLOT_DIFFUSE = 0, SLOT_SPECULAR, SLOT_NORMAL, SLOT_HEIGHT, SLOT_AO, SLOT_METALLIC, SLOT_ROUGHNESS, SLOT_COUNT
+};
+
+// Texture::type of each slot, as written by Model::processMesh
+static const char* const materialSlotNames[SLOT_COUNT] = {
+    "texture_diffuse", "texture_specular", "texture_normal", "texture_height",
+    "texture_ao", "texture_metallic", "texture_roughness"
+};
+
+// Material had the full set of four maps, metallic and normal maps can be sampled
+#define MATERIAL_PACKET_FULL (1u << 0)
+#define DRAW_PACKET_SKINNED (1u << 0)
+
+// Permutation flags of the G-buffer shaders, bit i defines gBufferVariantNames[i]. The
+// frame picks the material path, each packet adds what its material needs on top.
+#define VARIANT_MATERIAL_TABLE (1u << 0)
+#define VARIANT_BINDLESS (1u << 1)
+#define VARIANT_ALBEDO_MAP (1u << 2)
+
+static const char* const gBufferVariantNames[] = { "MATERIAL_TABLE", "BINDLESS", "ALBEDO_MAP" };
+
+// GL state of one material, flattened out of Material when the model is loaded
+struct MaterialPacket {
+    unsigned int textures[SLOT_COUNT];
+    unsigned int flags;
+
+    // Same for every material binding the same textures, across models
+    unsigned int id;
+};
+
+// Everything a direct draw of one mesh needs
+struct DrawPacket {
+    unsigned int VAO;
+    unsigned int indexCount;
+    unsigned int material;
+    unsigned int flags;
+
+    // VARIANT_* flags of the material, only used when materials are bound per draw
+    unsigned int variant;
+
+    // Meshes with identical vertices and indices share the geometry, and with it the VAO
+    unsigned int geometry;
+};
\ No newline at end of file
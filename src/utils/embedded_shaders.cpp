@@ -0,0 +1,10 @@
+#include "embedded_shaders.h"
+
+#include <algorithm>
+
+const EmbeddedShader* findEmbeddedShader(std::string_view path) {
+    const EmbeddedShader* end = embeddedShaders + embeddedShaderCount;
+    const EmbeddedShader* shader = std::lower_bound(embeddedShaders, end, path,
+        [](const EmbeddedShader& shader, std::string_view path) { return shader.path < path; });
+    return shader != end && shader->path == path ? shader : nullptr;
+}
\ No newline at end of file
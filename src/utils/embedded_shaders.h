@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// A file of the shader directory compiled into gl_tools by exes/shader_embedder.cpp.
+// Includes are already expanded, the way ProgramBuilder::preprocess does it.
+struct EmbeddedShader {
+    std::string_view path;
+    std::string_view source;
+
+    // Of source, so it changes whenever the file or anything it includes does
+    uint64_t hash;
+
+    // path, then everything it included, in #line numbering order
+    const std::string_view* files;
+    unsigned int fileCount;
+};
+
+// Sorted by path, generated at build time
+extern const EmbeddedShader embeddedShaders[];
+extern const unsigned int embeddedShaderCount;
+
+// nullptr for files that weren't there when gl_tools was built
+const EmbeddedShader* findEmbeddedShader(std::string_view path);
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "functions.h"
 #include "stb_image.h"
+#include "gl_state.h"
 
 #include <glad/glad.h>
 #include <iostream>
@@ -166,9 +167,7 @@ namespace glutil {
 
     unsigned int createCubemap(int width, int height, GLenum dataType, GLenum format, GLenum storageFormat, int nrComponents) {
         unsigned int cubemapID;
-        
-        glGenTextures(1, &cubemapID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapID);
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &cubemapID);
 
         if (nrComponents == 0) {
             format = GL_DEPTH_COMPONENT;
@@ -184,30 +183,28 @@ namespace glutil {
             storageFormat = GL_RGBA8;
         }
 
-        for (int i = 0; i < 6; i++) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, storageFormat, width, height, 0,
-                format, dataType, nullptr);
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); 
-        }
+        // Immutable storage needs a sized format
+        if (storageFormat == GL_DEPTH_COMPONENT) storageFormat = GL_DEPTH_COMPONENT24;
+        glTextureStorage2D(cubemapID, 1, storageFormat, width, height);
+
+        glTextureParameteri(cubemapID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(cubemapID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(cubemapID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(cubemapID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(cubemapID, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
         return cubemapID;
     }
 
     unsigned int loadCubemap(std::string path, std::vector<std::string> faces) {
         unsigned int textureID;
-        
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &textureID);
 
         int width, height, nrChannels;
 
         GLenum format;
         GLenum storageFormat;
+        bool allocated = false;
 
         for (int i = 0; i < 6; i++) {
             std::string facePath = path + faces[i];
@@ -225,14 +222,14 @@ namespace glutil {
                     storageFormat = GL_RGBA8;
                 }
 
-               glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, storageFormat, width, height, 0, format,
-                GL_UNSIGNED_BYTE, data);
+                // Storage covers all six faces, sized by the first one that loads
+                if (!allocated) {
+                    glTextureStorage2D(textureID, 1, storageFormat, width, height);
+                    allocated = true;
+                }
 
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+                // Faces are the layers of a cube map, in GL_TEXTURE_CUBE_MAP_POSITIVE_X order
+                glTextureSubImage3D(textureID, 0, 0, 0, i, width, height, 1, format, GL_UNSIGNED_BYTE, data);
 
                 stbi_image_free(data);
             } else {
@@ -241,6 +238,12 @@ namespace glutil {
             }
         }
 
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
         return textureID;
     }
 
@@ -252,7 +255,7 @@ namespace glutil {
         glCreateBuffers(1, &VBO);
         glNamedBufferStorage(VBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
@@ -289,7 +292,7 @@ namespace glutil {
         glCreateBuffers(1, &EBO);
         glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
@@ -329,7 +332,7 @@ namespace glutil {
         glCreateBuffers(1, &EBO);
         glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
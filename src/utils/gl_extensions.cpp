@@ -0,0 +1,60 @@
+#include "gl_extensions.h"
+
+#include <SDL.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<std::string> extensions;
+
+    template<typename T>
+    bool loadProc(T& proc, const char* name) {
+        proc = reinterpret_cast<T>(SDL_GL_GetProcAddress(name));
+        return proc != nullptr;
+    }
+}
+
+namespace glext {
+    bool ARB_bindless_texture = false;
+
+    PFNGLGETTEXTUREHANDLEARBPROC glGetTextureHandleARB = nullptr;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glMakeTextureHandleResidentARB = nullptr;
+    PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glMakeTextureHandleNonResidentARB = nullptr;
+
+    bool KHR_parallel_shader_compile = false;
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = nullptr;
+
+    void load() {
+        extensions.clear();
+
+        GLint numExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+        for (int i = 0; i < numExtensions; i++) {
+            extensions.push_back((const char*)glGetStringi(GL_EXTENSIONS, i));
+        }
+
+        ARB_bindless_texture = hasExtension("GL_ARB_bindless_texture")
+            && loadProc(glGetTextureHandleARB, "glGetTextureHandleARB")
+            && loadProc(glMakeTextureHandleResidentARB, "glMakeTextureHandleResidentARB")
+            && loadProc(glMakeTextureHandleNonResidentARB, "glMakeTextureHandleNonResidentARB");
+
+        std::cout << "Bindless textures " << (ARB_bindless_texture ? "supported" : "not supported") << "\n";
+
+        KHR_parallel_shader_compile = (hasExtension("GL_KHR_parallel_shader_compile")
+                && loadProc(glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR"))
+            || (hasExtension("GL_ARB_parallel_shader_compile")
+                && loadProc(glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsARB"));
+
+        // Let the driver pick how many threads compile in the background
+        if (KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        std::cout << "Parallel shader compile " << (KHR_parallel_shader_compile ? "supported" : "not supported") << "\n";
+    }
+
+    bool hasExtension(std::string_view name) {
+        for (const std::string& extension : extensions) {
+            if (extension == name) return true;
+        }
+        return false;
+    }
+};
\ No newline at end of file
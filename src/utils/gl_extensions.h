@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string_view>
+
+// glad is generated for core 4.6 only, the few extensions the engine uses are loaded here
+
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace glext {
+    // Set by load(), false when the extension or one of its entry points is missing
+    extern bool ARB_bindless_texture;
+
+    extern PFNGLGETTEXTUREHANDLEARBPROC glGetTextureHandleARB;
+    extern PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glMakeTextureHandleResidentARB;
+    extern PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glMakeTextureHandleNonResidentARB;
+
+    // KHR or ARB flavour, both share the enums. With it GL_COMPLETION_STATUS_KHR can be
+    // polled without blocking on a compile or link.
+    extern bool KHR_parallel_shader_compile;
+    extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+
+    // Needs a current context
+    void load();
+    bool hasExtension(std::string_view name);
+};
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "gl_state.h"
+#include "render_stats.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    const unsigned int UNKNOWN = ~0u;
+
+    unsigned int* findBinding(GLenum target, unsigned int index, unsigned int* uniformBuffers, unsigned int* storageBuffers) {
+        if (index >= GLState::MAX_BUFFER_BINDINGS) return nullptr;
+        if (target == GL_UNIFORM_BUFFER) return &uniformBuffers[index];
+        if (target == GL_SHADER_STORAGE_BUFFER) return &storageBuffers[index];
+        return nullptr;
+    }
+
+    void forgetName(unsigned int* bindings, int size, unsigned int name) {
+        for (int i = 0; i < size; i++) {
+            if (bindings[i] == name) bindings[i] = 0;
+        }
+    }
+}
+
+bool GLState::debugValidation = false;
+
+// A fresh context has nothing bound
+unsigned int GLState::program = 0;
+unsigned int GLState::vertexArray = 0;
+unsigned int GLState::framebuffer = 0;
+unsigned int GLState::drawIndirectBuffer = 0;
+unsigned int GLState::parameterBuffer = 0;
+unsigned int GLState::textures[MAX_TEXTURE_UNITS] = {};
+unsigned int GLState::uniformBuffers[MAX_BUFFER_BINDINGS] = {};
+unsigned int GLState::storageBuffers[MAX_BUFFER_BINDINGS] = {};
+
+void GLState::useProgram(unsigned int value) {
+    if (program == value) {
+        RenderStats::countRedundantBind();
+        return;
+    }
+
+    program = value;
+    glUseProgram(value);
+    RenderStats::countProgramBind();
+    forwarded("glUseProgram");
+}
+
+void GLState::bindVertexArray(unsigned int value) {
+    if (vertexArray == value) {
+        RenderStats::countRedundantBind();
+        return;
+    }
+
+    vertexArray = value;
+    glBindVertexArray(value);
+    RenderStats::countVAOBind();
+    forwarded("glBindVertexArray");
+}
+
+void GLState::bindTextureUnit(unsigned int unit, unsigned int texture) {
+    if (unit < MAX_TEXTURE_UNITS) {
+        if (textures[unit] == texture) {
+            RenderStats::countRedundantBind();
+            return;
+        }
+        textures[unit] = texture;
+    }
+
+    glBindTextureUnit(unit, texture);
+    RenderStats::countTextureBind();
+    forwarded("glBindTextureUnit");
+}
+
+void GLState::bindFramebuffer(unsigned int value) {
+    if (framebuffer == value) {
+        RenderStats::countRedundantBind();
+        return;
+    }
+
+    framebuffer = value;
+    glBindFramebuffer(GL_FRAMEBUFFER, value);
+    RenderStats::countFramebufferBind();
+    forwarded("glBindFramebuffer");
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int buffer) {
+    unsigned int* shadow = target == GL_DRAW_INDIRECT_BUFFER ? &drawIndirectBuffer
+        : target == GL_PARAMETER_BUFFER ? &parameterBuffer : nullptr;
+
+    if (shadow != nullptr) {
+        if (*shadow == buffer) {
+            RenderStats::countRedundantBind();
+            return;
+        }
+        *shadow = buffer;
+    }
+
+    glBindBuffer(target, buffer);
+    RenderStats::countBufferBind();
+    forwarded("glBindBuffer");
+}
+
+void GLState::bindBufferBase(GLenum target, unsigned int index, unsigned int buffer) {
+    unsigned int* shadow = findBinding(target, index, uniformBuffers, storageBuffers);
+    if (shadow != nullptr) {
+        if (*shadow == buffer) {
+            RenderStats::countRedundantBind();
+            return;
+        }
+        *shadow = buffer;
+    }
+
+    glBindBufferBase(target, index, buffer);
+    RenderStats::countBufferBind();
+    forwarded("glBindBufferBase");
+}
+
+void GLState::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size) {
+    unsigned int* shadow = findBinding(target, index, uniformBuffers, storageBuffers);
+    if (shadow != nullptr) *shadow = UNKNOWN;
+
+    glBindBufferRange(target, index, buffer, offset, size);
+    RenderStats::countBufferBind();
+    forwarded("glBindBufferRange");
+}
+
+void GLState::deleteProgram(unsigned int value) {
+    glDeleteProgram(value);
+    if (program == value) program = UNKNOWN;
+}
+
+void GLState::deleteVertexArrays(int count, const unsigned int* vaos) {
+    glDeleteVertexArrays(count, vaos);
+    for (int i = 0; i < count; i++) {
+        if (vaos[i] != 0 && vertexArray == vaos[i]) vertexArray = 0;
+    }
+}
+
+void GLState::deleteTextures(int count, const unsigned int* names) {
+    glDeleteTextures(count, names);
+    for (int i = 0; i < count; i++) {
+        if (names[i] != 0) forgetName(textures, MAX_TEXTURE_UNITS, names[i]);
+    }
+}
+
+void GLState::deleteFramebuffers(int count, const unsigned int* framebuffers) {
+    glDeleteFramebuffers(count, framebuffers);
+    for (int i = 0; i < count; i++) {
+        if (framebuffers[i] != 0 && framebuffer == framebuffers[i]) framebuffer = 0;
+    }
+}
+
+void GLState::deleteBuffers(int count, const unsigned int* buffers) {
+    glDeleteBuffers(count, buffers);
+    for (int i = 0; i < count; i++) {
+        unsigned int name = buffers[i];
+        if (name == 0) continue;
+
+        if (drawIndirectBuffer == name) drawIndirectBuffer = 0;
+        if (parameterBuffer == name) parameterBuffer = 0;
+        forgetName(uniformBuffers, MAX_BUFFER_BINDINGS, name);
+        forgetName(storageBuffers, MAX_BUFFER_BINDINGS, name);
+    }
+}
+
+void GLState::invalidate() {
+    program = vertexArray = framebuffer = UNKNOWN;
+    drawIndirectBuffer = parameterBuffer = UNKNOWN;
+    std::fill(textures, textures + MAX_TEXTURE_UNITS, UNKNOWN);
+    std::fill(uniformBuffers, uniformBuffers + MAX_BUFFER_BINDINGS, UNKNOWN);
+    std::fill(storageBuffers, storageBuffers + MAX_BUFFER_BINDINGS, UNKNOWN);
+}
+
+bool GLState::validate() {
+    bool valid = true;
+    auto check = [&valid](const char* name, int index, unsigned int shadow, GLint actual) {
+        if (shadow == UNKNOWN || shadow == static_cast<unsigned int>(actual)) return;
+
+        std::cout << "GL state mismatch: " << name;
+        if (index >= 0) std::cout << "[" << index << "]";
+        std::cout << " shadowed as " << shadow << ", bound is " << actual << "\n";
+        valid = false;
+    };
+
+    GLint value = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+    check("program", -1, program, value);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+    check("vertex array", -1, vertexArray, value);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &value);
+    check("draw framebuffer", -1, framebuffer, value);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &value);
+    check("read framebuffer", -1, framebuffer, value);
+    glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &value);
+    check("draw indirect buffer", -1, drawIndirectBuffer, value);
+    glGetIntegerv(GL_PARAMETER_BUFFER_BINDING, &value);
+    check("parameter buffer", -1, parameterBuffer, value);
+
+    for (int i = 0; i < MAX_BUFFER_BINDINGS; i++) {
+        glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, i, &value);
+        check("uniform buffer", i, uniformBuffers[i], value);
+        glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, i, &value);
+        check("storage buffer", i, storageBuffers[i], value);
+    }
+
+    // glBindTextureUnit picks the target from the texture, so any of them may hold it
+    GLint activeTexture = GL_TEXTURE0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+        if (textures[i] == UNKNOWN) continue;
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        GLint bound[3] = {};
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound[0]);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &bound[1]);
+        glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &bound[2]);
+
+        bool found = std::find(bound, bound + 3, static_cast<GLint>(textures[i])) != bound + 3;
+        if (textures[i] == 0) found = bound[0] == 0 && bound[1] == 0 && bound[2] == 0;
+        check("texture unit", i, textures[i], found ? static_cast<GLint>(textures[i]) : bound[0]);
+    }
+    glActiveTexture(activeTexture);
+
+    return valid;
+}
+
+void GLState::forwarded(const char* call) {
+    if (debugValidation && !validate()) {
+        std::cout << "  after " << call << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Shadow copy of the bindings the engine changes every frame. Calls matching the shadow
+// are skipped and counted as redundant, the rest go to GL and the RenderStats counters.
+// Code binding these objects behind its back has to call invalidate() afterwards.
+class GLState {
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+    static const int MAX_BUFFER_BINDINGS = 16;
+
+    static void useProgram(unsigned int program);
+    static void bindVertexArray(unsigned int vao);
+    static void bindTextureUnit(unsigned int unit, unsigned int texture);
+    static void bindFramebuffer(unsigned int framebuffer);
+
+    // GL_DRAW_INDIRECT_BUFFER and GL_PARAMETER_BUFFER, other targets pass straight through
+    static void bindBuffer(GLenum target, unsigned int buffer);
+
+    // GL_UNIFORM_BUFFER and GL_SHADER_STORAGE_BUFFER
+    static void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer);
+
+    // Ranges always reach GL, the slot is left unknown for the next bindBufferBase
+    static void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+
+    // Deleting an object unbinds it in GL, these keep the shadow in sync since names get reused
+    static void deleteProgram(unsigned int program);
+    static void deleteVertexArrays(int count, const unsigned int* vaos);
+    static void deleteTextures(int count, const unsigned int* textures);
+    static void deleteFramebuffers(int count, const unsigned int* framebuffers);
+    static void deleteBuffers(int count, const unsigned int* buffers);
+
+    // Marks every binding unknown, the next call of each kind always reaches GL
+    static void invalidate();
+
+    // Queries GL for every shadowed binding and prints mismatches. With debugValidation
+    // set this runs after each forwarded call, which is slow but pinpoints the culprit.
+    static bool validate();
+    static bool debugValidation;
+
+private:
+    // ~0u marks a binding whose real value is unknown
+    static unsigned int program;
+    static unsigned int vertexArray;
+    static unsigned int framebuffer;
+    static unsigned int drawIndirectBuffer, parameterBuffer;
+    static unsigned int textures[MAX_TEXTURE_UNITS];
+    static unsigned int uniformBuffers[MAX_BUFFER_BINDINGS];
+    static unsigned int storageBuffers[MAX_BUFFER_BINDINGS];
+
+    static void forwarded(const char* call);
+};
\ No newline at end of file
@@ -148,6 +148,42 @@ Model::Model(std::string path, FileType type) {
     model_matrix = glm::mat4(1.0f);
 }
 
+void Model::setTransform(const glm::mat4& matrix) {
+    model_matrix = matrix;
+    for (Mesh& mesh : meshes) {
+        mesh.boundsDirty = true;
+    }
+    boundsDirty = true;
+    transformVersion++;
+}
+
+void Model::markMeshDirty(Mesh& mesh) {
+    mesh.boundsDirty = true;
+    boundsDirty = true;
+    transformVersion++;
+}
+
+void Model::updateBounds() {
+    if (!boundsDirty) return;
+
+    worldAABB.isInitialized = false;
+    for (Mesh& mesh : meshes) {
+        if (mesh.boundsDirty) {
+            mesh.worldAABB = mesh.aabb.transform(mesh.model_matrix * model_matrix);
+            mesh.boundsDirty = false;
+        }
+
+        if (!worldAABB.isInitialized) {
+            worldAABB = mesh.worldAABB;
+        }
+        else {
+            worldAABB.minPoint = glm::min(worldAABB.minPoint, mesh.worldAABB.minPoint);
+            worldAABB.maxPoint = glm::max(worldAABB.maxPoint, mesh.worldAABB.maxPoint);
+        }
+    }
+    boundsDirty = false;
+}
+
 void Model::loadInfo(std::string path, FileType type) {
     int fileTypeInfo[2] = {
         aiProcess_ConvertToLeftHanded, 0
@@ -13,6 +13,7 @@
 
 #include "types.h"
 #include "material.h"
+#include "draw_packet.h"
 
 struct NodeData {
     glm::mat4 transformation;
@@ -34,9 +35,16 @@ struct Mesh {
     glm::mat4 model_matrix;
     BoundingBox aabb;
 
+    // Cached world-space bounds, recomputed by Model::updateBounds when dirty
+    BoundingBox worldAABB;
+    bool boundsDirty = true;
+
     AllocatedBuffer buffer;
     unsigned int SSBO;
 
+    // Index into the engine's geometry cache, shared by meshes with identical data
+    unsigned int geometry = 0;
+
     void getBoneTransforms(float time, const aiScene* scene, std::vector<NodeData>& nodeData, int animationIndex = 0);
     const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string nodeName);
 
@@ -45,6 +53,12 @@ struct Mesh {
     void calcInterpolatedPosition(aiVector3D& out, float animationTicks, const aiNodeAnim* nodeAnim);
 };
 
+// Flat reference to a mesh across all loaded models
+struct MeshRef {
+    unsigned int modelIndex;
+    unsigned int meshIndex;
+};
+
 enum FileType {
     GLTF = 0, OBJ
 };
@@ -61,10 +75,22 @@ class Model {
 
         std::vector<Material> materials_loaded;
 
+        // Built by the engine from meshes and materials_loaded, one per mesh and per material.
+        // Set packetsDirty after editing either so they get rebuilt before the next draw.
+        std::vector<DrawPacket> drawPackets;
+        std::vector<MaterialPacket> materialPackets;
+        bool packetsDirty = true;
+
         std::string directory;
         bool gammaCorrection;
         glm::mat4 model_matrix;
         BoundingBox aabb;
+        BoundingBox worldAABB;
+        bool boundsDirty = true;
+
+        // Bumped whenever the model or one of its meshes moves. The engine compares it with
+        // the version it last synced, so bounds read elsewhere (picking, baking) never hide a move.
+        unsigned int transformVersion = 0;
         bool shouldDraw = true;
         int numAnimations = 0;
 
@@ -72,6 +98,11 @@ class Model {
 
         Model();
         Model(std::string path, FileType type = OBJ);
+
+        // Use instead of writing model_matrix directly so cached bounds get refreshed
+        void setTransform(const glm::mat4& matrix);
+        void markMeshDirty(Mesh& mesh);
+        void updateBounds();
     private:
         void loadInfo(std::string path, FileType type);
 
@@ -0,0 +1,264 @@
+#include "occlusion_rasterizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "utils/thread_pool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    const float NEAR_EPSILON = 1e-5f;
+
+    float elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+OcclusionRasterizer::OcclusionRasterizer() {
+    tileBins.resize(TILES_X * TILES_Y);
+    depth.assign(WIDTH * HEIGHT, 1.0f);
+    blockMaxDepth.assign(BLOCKS_X * BLOCKS_Y, 1.0f);
+}
+
+void OcclusionRasterizer::beginFrame(const glm::mat4& matrix) {
+    viewProj = matrix;
+    occluders.clear();
+    triangles.clear();
+    stats = {};
+}
+
+void OcclusionRasterizer::addOccluder(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model) {
+    // Every triangle gets a slot up front so workers can set up occluders without sharing an array
+    occluders.push_back({ &vertices, &indices, viewProj * model, triangles.size(), 0 });
+    triangles.resize(triangles.size() + indices.size() / 3);
+    stats.occluders++;
+}
+
+void OcclusionRasterizer::setupOccluder(Occluder& occluder, std::vector<glm::vec4>& clipPositions) {
+    const std::vector<Vertex>& vertices = *occluder.vertices;
+    const std::vector<unsigned int>& indices = *occluder.indices;
+
+    clipPositions.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        clipPositions[i] = occluder.matrix * glm::vec4(vertices[i].Position, 1.0f);
+    }
+
+    // Survivors are packed to the front of the occluder's slots
+    ScreenTriangle* output = triangles.data() + occluder.firstTriangle;
+    occluder.triangleCount = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        ScreenTriangle triangle;
+        bool clipped = false;
+
+        for (int j = 0; j < 3; j++) {
+            const glm::vec4& clip = clipPositions[indices[i + j]];
+
+            // Dropping occluder triangles that cross the near plane only loses culling, never correctness
+            if (clip.w <= NEAR_EPSILON || clip.z < -clip.w) {
+                clipped = true;
+                break;
+            }
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            triangle.v[j] = glm::vec3(
+                (ndc.x * 0.5f + 0.5f) * WIDTH,
+                (ndc.y * 0.5f + 0.5f) * HEIGHT,
+                ndc.z * 0.5f + 0.5f);
+        }
+        if (clipped) continue;
+
+        output[occluder.triangleCount++] = triangle;
+    }
+}
+
+void OcclusionRasterizer::rasterize() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Transform and clip, each chunk of occluders reuses its own clip space scratch
+    ThreadPool::shared().parallelFor(occluders.size(), 4, [this](size_t begin, size_t end) {
+        std::vector<glm::vec4> clipPositions;
+        for (size_t i = begin; i < end; i++) setupOccluder(occluders[i], clipPositions);
+    });
+
+    for (auto& bin : tileBins) bin.clear();
+
+    stats.triangles = 0;
+    for (const Occluder& occluder : occluders) {
+        stats.triangles += static_cast<unsigned int>(occluder.triangleCount);
+
+        for (size_t i = occluder.firstTriangle; i < occluder.firstTriangle + occluder.triangleCount; i++) {
+            const ScreenTriangle& triangle = triangles[i];
+            glm::vec2 minPoint = glm::min(glm::min(glm::vec2(triangle.v[0]), glm::vec2(triangle.v[1])), glm::vec2(triangle.v[2]));
+            glm::vec2 maxPoint = glm::max(glm::max(glm::vec2(triangle.v[0]), glm::vec2(triangle.v[1])), glm::vec2(triangle.v[2]));
+
+            if (maxPoint.x < 0.0f || maxPoint.y < 0.0f || minPoint.x >= WIDTH || minPoint.y >= HEIGHT) continue;
+
+            int tileX0 = std::max(0, (int)minPoint.x / TILE_SIZE);
+            int tileY0 = std::max(0, (int)minPoint.y / TILE_SIZE);
+            int tileX1 = std::min(TILES_X - 1, (int)maxPoint.x / TILE_SIZE);
+            int tileY1 = std::min(TILES_Y - 1, (int)maxPoint.y / TILE_SIZE);
+
+            for (int y = tileY0; y <= tileY1; y++) {
+                for (int x = tileX0; x <= tileX1; x++) {
+                    tileBins[y * TILES_X + x].push_back(static_cast<unsigned int>(i));
+                }
+            }
+        }
+    }
+
+    // Tiles never share pixels, so workers only have to agree on who takes which tile
+    ThreadPool::shared().parallelFor(TILES_X * TILES_Y, 1, [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) rasterizeTile(static_cast<int>(tile));
+    });
+
+    stats.rasterizeTime += elapsedMilliseconds(start);
+}
+
+void OcclusionRasterizer::rasterizeTile(int tileIndex) {
+    int tileX = (tileIndex % TILES_X) * TILE_SIZE;
+    int tileY = (tileIndex / TILES_X) * TILE_SIZE;
+
+    for (int y = tileY; y < tileY + TILE_SIZE; y++) {
+        std::fill(depth.begin() + y * WIDTH + tileX, depth.begin() + y * WIDTH + tileX + TILE_SIZE, 1.0f);
+    }
+
+    for (unsigned int triangleIndex : tileBins[tileIndex]) {
+        const ScreenTriangle& triangle = triangles[triangleIndex];
+        glm::vec3 v0 = triangle.v[0], v1 = triangle.v[1], v2 = triangle.v[2];
+
+        // Occluders are treated as two sided, flip clockwise triangles instead of dropping them
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (std::fabs(area) < 1e-8f) continue;
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        // Edge functions as A * x + B * y + C, each one weights the vertex opposite to it
+        float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+        float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+        float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+        // Depth is affine in screen space: z = zA * x + zB * y + zC
+        float inverseArea = 1.0f / area;
+        float zA = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * inverseArea;
+        float zB = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * inverseArea;
+        float zC = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * inverseArea;
+
+        float minX = std::min(std::min(v0.x, v1.x), v2.x);
+        float maxX = std::max(std::max(v0.x, v1.x), v2.x);
+        float minY = std::min(std::min(v0.y, v1.y), v2.y);
+        float maxY = std::max(std::max(v0.y, v1.y), v2.y);
+
+        // Starting on a multiple of four keeps every 4 wide span inside the tile
+        int x0 = std::max(tileX, (int)std::floor(minX)) & ~3;
+        int x1 = std::min(tileX + TILE_SIZE - 1, (int)std::floor(maxX));
+        int y0 = std::max(tileY, (int)std::floor(minY));
+        int y1 = std::min(tileY + TILE_SIZE - 1, (int)std::floor(maxY));
+
+        for (int y = y0; y <= y1; y++) {
+            float pixelY = y + 0.5f;
+            float* row = depth.data() + y * WIDTH;
+
+#ifdef OCCLUSION_SSE2
+            __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 zero = _mm_setzero_ps();
+            __m128 edgeA0 = _mm_set1_ps(a0), edgeA1 = _mm_set1_ps(a1), edgeA2 = _mm_set1_ps(a2);
+            __m128 rowE0 = _mm_set1_ps(b0 * pixelY + c0);
+            __m128 rowE1 = _mm_set1_ps(b1 * pixelY + c1);
+            __m128 rowE2 = _mm_set1_ps(b2 * pixelY + c2);
+            __m128 depthA = _mm_set1_ps(zA);
+            __m128 rowZ = _mm_set1_ps(zB * pixelY + zC);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), rowE0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), rowE1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), rowE2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowZ);
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                float pixelX = x + 0.5f;
+                if (a0 * pixelX + b0 * pixelY + c0 < 0.0f) continue;
+                if (a1 * pixelX + b1 * pixelY + c1 < 0.0f) continue;
+                if (a2 * pixelX + b2 * pixelY + c2 < 0.0f) continue;
+
+                float z = zA * pixelX + zB * pixelY + zC;
+                row[x] = std::min(row[x], z);
+            }
+#endif
+        }
+    }
+
+    for (int blockY = tileY / BLOCK_SIZE; blockY < (tileY + TILE_SIZE) / BLOCK_SIZE; blockY++) {
+        for (int blockX = tileX / BLOCK_SIZE; blockX < (tileX + TILE_SIZE) / BLOCK_SIZE; blockX++) {
+            float farthest = 0.0f;
+            for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++) {
+                const float* row = depth.data() + y * WIDTH + blockX * BLOCK_SIZE;
+                for (int x = 0; x < BLOCK_SIZE; x++) farthest = std::max(farthest, row[x]);
+            }
+            blockMaxDepth[blockY * BLOCKS_X + blockX] = farthest;
+        }
+    }
+}
+
+bool OcclusionRasterizer::isVisible(const BoundingBox& box) const {
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearestDepth = FLT_MAX;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner(
+            (i & 1) ? box.maxPoint.x : box.minPoint.x,
+            (i & 2) ? box.maxPoint.y : box.minPoint.y,
+            (i & 4) ? box.maxPoint.z : box.minPoint.z,
+            1.0f);
+        glm::vec4 clip = viewProj * corner;
+
+        // Boxes reaching behind the near plane can cover the whole screen
+        if (clip.w <= NEAR_EPSILON || clip.z < -clip.w) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    int x0 = std::max(0, (int)std::floor(screenMin.x));
+    int y0 = std::max(0, (int)std::floor(screenMin.y));
+    int x1 = std::min(WIDTH - 1, (int)std::floor(screenMax.x));
+    int y1 = std::min(HEIGHT - 1, (int)std::floor(screenMax.y));
+    if (x0 > x1 || y0 > y1) return false;
+
+    for (int blockY = y0 / BLOCK_SIZE; blockY <= y1 / BLOCK_SIZE; blockY++) {
+        for (int blockX = x0 / BLOCK_SIZE; blockX <= x1 / BLOCK_SIZE; blockX++) {
+            // Everything in this block is closer than the box
+            if (nearestDepth > blockMaxDepth[blockY * BLOCKS_X + blockX]) continue;
+
+            int startX = std::max(x0, blockX * BLOCK_SIZE), endX = std::min(x1, blockX * BLOCK_SIZE + BLOCK_SIZE - 1);
+            int startY = std::max(y0, blockY * BLOCK_SIZE), endY = std::min(y1, blockY * BLOCK_SIZE + BLOCK_SIZE - 1);
+            for (int y = startY; y <= endY; y++) {
+                const float* row = depth.data() + y * WIDTH;
+                for (int x = startX; x <= endX; x++) {
+                    if (nearestDepth <= row[x]) return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
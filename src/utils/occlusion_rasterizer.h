@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "utils/types.h"
+
+struct OcclusionStats {
+    unsigned int occluders = 0;
+    unsigned int triangles = 0;
+    unsigned int tested = 0;
+    unsigned int culled = 0;
+
+    // Milliseconds spent transforming, binning and rasterizing occluders / testing occludees
+    float rasterizeTime = 0.0f;
+    float testTime = 0.0f;
+
+    float cullRate() const { return tested > 0 ? static_cast<float>(culled) / tested : 0.0f; }
+};
+
+// Low resolution depth-only rasterizer for occlusion culling on the CPU. Occluders are
+// transformed in parallel, the screen is split into tiles that the shared thread pool fills
+// independently, and each 8x8 block keeps its
+// farthest depth so most occludee tests never touch individual pixels. Nothing here
+// touches GL, so it behaves the same with or without a context.
+class OcclusionRasterizer {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+    static const int TILE_SIZE = 32;
+    static const int BLOCK_SIZE = 8;
+    static const int TILES_X = WIDTH / TILE_SIZE;
+    static const int TILES_Y = HEIGHT / TILE_SIZE;
+    static const int BLOCKS_X = WIDTH / BLOCK_SIZE;
+    static const int BLOCKS_Y = HEIGHT / BLOCK_SIZE;
+
+    OcclusionRasterizer();
+
+    void beginFrame(const glm::mat4& viewProj);
+
+    // Only records the occluder, the mesh data has to stay alive until rasterize
+    void addOccluder(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model);
+    void rasterize();
+
+    // Conservative: only returns false when every pixel the box could cover is
+    // already closer in the depth buffer
+    bool isVisible(const BoundingBox& box) const;
+
+    // Depth in [0, 1], row 0 is the bottom of the screen
+    const std::vector<float>& getDepth() const { return depth; }
+
+    OcclusionStats stats;
+
+private:
+    struct ScreenTriangle {
+        glm::vec3 v[3];
+    };
+
+    struct Occluder {
+        const std::vector<Vertex>* vertices;
+        const std::vector<unsigned int>* indices;
+        glm::mat4 matrix;
+
+        // Slots in triangles reserved for this occluder, and how many survived clipping
+        size_t firstTriangle;
+        size_t triangleCount;
+    };
+
+    glm::mat4 viewProj = glm::mat4(1.0f);
+
+    std::vector<Occluder> occluders;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<unsigned int>> tileBins;
+
+    std::vector<float> depth;
+    std::vector<float> blockMaxDepth;
+
+    void setupOccluder(Occluder& occluder, std::vector<glm::vec4>& clipPositions);
+    void rasterizeTile(int tileIndex);
+};
\ No newline at end of file
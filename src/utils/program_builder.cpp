@@ -0,0 +1,154 @@
+#include "program_builder.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+#include "embedded_shaders.h"
+#include "shader_includes.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+std::string ProgramBuilder::directory = "../shaders/";
+bool ProgramBuilder::useEmbedded = true;
+std::set<std::string> ProgramBuilder::overrides;
+
+std::string ProgramBuilder::readSource(const std::string& path) {
+    std::ifstream file(directory + path);
+    if (!file) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << directory + path << std::endl;
+        return "";
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+std::string ProgramBuilder::preprocess(const std::string& path, const ShaderDefines& defines, std::vector<std::string>& files,
+    uint64_t* hash) {
+    std::string prelude;
+    for (const auto& define : defines) {
+        prelude += "#define " + define.first + " " + define.second + "\n";
+    }
+
+    const EmbeddedShader* embedded = useEmbedded ? findEmbeddedShader(path) : nullptr;
+    if (embedded != nullptr) {
+        files.assign(embedded->files, embedded->files + embedded->fileCount);
+        bool overridden = std::any_of(files.begin(), files.end(),
+            [](const std::string& file) { return overrides.count(file) != 0; });
+
+        // Same layout expand produces, the defines go right after #version
+        size_t version = embedded->source.find("#version");
+        size_t lineEnd = version == std::string_view::npos ? version : embedded->source.find('\n', version);
+        if (!overridden && lineEnd != std::string_view::npos) {
+            if (hash != nullptr) {
+                ProgramCache::Key key;
+                key.hash = embedded->hash;
+                key.add(prelude);
+                *hash = key.hash;
+            }
+
+            std::string out(embedded->source.substr(0, lineEnd + 1));
+            out += prelude;
+            out += embedded->source.substr(lineEnd + 1);
+            return out;
+        }
+    }
+
+    files.clear();
+    std::string out;
+    expandShaderIncludes(path, prelude, out, files, readSource);
+    return out;
+}
+
+unsigned int ProgramBuilder::start(const std::vector<ShaderStage>& stages, PendingProgram& pending) {
+    pending = {};
+    pending.key = ProgramCache::makeKey();
+    for (const ShaderStage& stage : stages) {
+        pending.key.add(stage.hash != 0 ? std::string_view(reinterpret_cast<const char*>(&stage.hash), sizeof(stage.hash)) : stage.source);
+    }
+
+    unsigned int program = glCreateProgram();
+    if (ProgramCache::load(program, pending.key)) return program;
+
+    for (const ShaderStage& stage : stages) {
+        const char* code = stage.source.c_str();
+        unsigned int shader = glCreateShader(stage.type);
+        glShaderSource(shader, 1, &code, nullptr);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+
+        pending.shaders.push_back(shader);
+        pending.names.push_back(stage.name);
+    }
+
+    // Linking right away queues it behind the compiles instead of waiting on them here
+    ProgramCache::prepare(program);
+    glLinkProgram(program);
+    pending.finished = false;
+    return program;
+}
+
+bool ProgramBuilder::isComplete(unsigned int program, const PendingProgram& pending) {
+    if (pending.finished || !glext::KHR_parallel_shader_compile) return true;
+
+    GLint complete = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+bool ProgramBuilder::finish(unsigned int program, PendingProgram& pending) {
+    if (pending.finished) return true;
+    pending.finished = true;
+
+    for (size_t i = 0; i < pending.shaders.size(); i++) {
+        checkCompileErrors(pending.shaders[i], pending.names[i]);
+    }
+    checkCompileErrors(program, "PROGRAM");
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked) ProgramCache::store(program, pending.key);
+
+    for (unsigned int shader : pending.shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    pending.shaders.clear();
+    pending.names.clear();
+
+    return linked == GL_TRUE;
+}
+
+void ProgramBuilder::cancel(unsigned int program, PendingProgram& pending) {
+    for (unsigned int shader : pending.shaders) {
+        glDeleteShader(shader);
+    }
+    GLState::deleteProgram(program);
+    pending = {};
+}
+
+void ProgramBuilder::checkCompileErrors(unsigned int shader, std::string type) {
+    int success;
+    char infoLog[1024];
+    if (type != "PROGRAM")
+    {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+    }
+    else
+    {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "program_cache.h"
+
+// Compile-time defines of one permutation, written as "#define NAME VALUE" after #version
+using ShaderDefines = std::map<std::string, std::string>;
+
+struct ShaderStage {
+    GLenum type;
+    // Shown in compile errors, e.g. "VERTEX"
+    std::string name;
+    std::string source;
+
+    // Known ahead for embedded sources, saves hashing source for the program cache key
+    uint64_t hash = 0;
+};
+
+// A program whose compiles and link were issued but not checked yet. The driver works
+// on it in the background with GL_KHR_parallel_shader_compile.
+struct PendingProgram {
+    std::vector<unsigned int> shaders;
+    std::vector<std::string> names;
+    ProgramCache::Key key;
+    bool finished = true;
+};
+
+class ProgramBuilder {
+public:
+    // Issues every compile and the link without waiting on any of them. The returned
+    // program can be used right away, GL blocks on first use if it isn't done.
+    static unsigned int start(const std::vector<ShaderStage>& stages, PendingProgram& pending);
+
+    // Never blocks with the extension, without it the answer is always yes
+    static bool isComplete(unsigned int program, const PendingProgram& pending);
+
+    // Prints compile and link errors, stores the binary and frees the shader objects.
+    // Blocks until the driver is done. Returns whether the program linked.
+    static bool finish(unsigned int program, PendingProgram& pending);
+
+    // Drops the program and its shader objects without looking at the result
+    static void cancel(unsigned int program, PendingProgram& pending);
+
+    static void checkCompileErrors(unsigned int shader, std::string type);
+
+    // path is relative to directory
+    static std::string readSource(const std::string& path);
+
+    // Sources come from the copies embedded at build time, without touching the disk.
+    // directory overrides them: files hot reload saw change, and files that weren't
+    // embedded, are read from there.
+    static std::string directory;
+    static bool useEmbedded;
+    static void overrideFile(const std::string& path) { overrides.insert(path); }
+    static size_t getOverrideCount() { return overrides.size(); }
+
+    // Reads path with its #include "file" lines expanded, each file at most once. Includes
+    // are relative to the including file. files receives path and everything it pulled in;
+    // #line directives use the position in that list as source string number, so a compile
+    // error reading 2(14) is line 14 of files[2]. hash is set for embedded sources.
+    static std::string preprocess(const std::string& path, const ShaderDefines& defines, std::vector<std::string>& files,
+        uint64_t* hash = nullptr);
+
+private:
+    static std::set<std::string> overrides;
+};
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "program_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    const char CACHE_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+
+    bool supportsBinaries() {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+}
+
+std::string ProgramCache::directory = "../shader_cache/";
+bool ProgramCache::enabled = true;
+unsigned int ProgramCache::hits = 0;
+unsigned int ProgramCache::misses = 0;
+
+void ProgramCache::Key::add(std::string_view text) {
+    // FNV-1a, with the length mixed in so "ab" + "c" and "a" + "bc" differ
+    uint64_t length = text.size();
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ ((length >> (i * 8)) & 0xff)) * 1099511628211ull;
+    }
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+}
+
+ProgramCache::Key ProgramCache::makeKey() {
+    Key key;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* value = reinterpret_cast<const char*>(glGetString(name));
+        key.add(value != nullptr ? value : "");
+    }
+    return key;
+}
+
+std::string ProgramCache::getPath(const Key& key) {
+    std::stringstream name;
+    name << directory << std::hex << key.hash << ".bin";
+    return name.str();
+}
+
+bool ProgramCache::load(unsigned int program, const Key& key) {
+    if (!enabled || !supportsBinaries()) return false;
+
+    std::ifstream file(getPath(key), std::ios::binary);
+    if (!file) {
+        misses++;
+        return false;
+    }
+
+    char magic[4] = {};
+    GLenum format = 0;
+    uint32_t length = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!file || !std::equal(magic, magic + 4, CACHE_MAGIC)) {
+        misses++;
+        return false;
+    }
+
+    // A truncated or corrupt file must not make us allocate whatever its header claims
+    std::streampos payloadStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - payloadStart;
+    file.seekg(payloadStart);
+    if (!file || static_cast<std::streamoff>(length) > remaining) {
+        misses++;
+        return false;
+    }
+
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file) {
+        misses++;
+        return false;
+    }
+
+    // Drivers refuse binaries from other versions or hardware by failing the link
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(length));
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    return true;
+}
+
+void ProgramCache::prepare(unsigned int program) {
+    if (enabled) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(unsigned int program, const Key& key) {
+    if (!enabled || !supportsBinaries()) return;
+
+    GLint success = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::ofstream file(getPath(key), std::ios::binary);
+    if (!file) {
+        std::cout << "Could not write program binary to " << getPath(key) << "\n";
+        return;
+    }
+
+    uint32_t size = static_cast<uint32_t>(length);
+    file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(binary.data(), length);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// glGetProgramBinary output kept on disk between runs. Entries are keyed by the program's
+// sources and defines together with the driver's vendor, renderer and version strings, so
+// a driver update or an edited shader simply misses instead of loading a stale binary.
+class ProgramCache {
+public:
+    // Accumulates a key, feed it every source and define string in a fixed order
+    struct Key {
+        uint64_t hash = 14695981039346656037ull;
+        void add(std::string_view text);
+    };
+
+    // Key already holding the driver strings, needs a current context
+    static Key makeKey();
+
+    // Tries glProgramBinary with the entry for key. False when there is none, the driver
+    // rejects it, or the cache is disabled; the program then has to be compiled.
+    static bool load(unsigned int program, const Key& key);
+
+    // Call before glLinkProgram on programs that will be stored
+    static void prepare(unsigned int program);
+    static void store(unsigned int program, const Key& key);
+
+    static std::string directory;
+    static bool enabled;
+
+    static unsigned int hits, misses;
+
+private:
+    static std::string getPath(const Key& key);
+};
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "pvs.h"
+#include "utils/bvh.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cfloat>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "utils/thread_pool.h"
+
+namespace {
+    const char PVS_MAGIC[4] = { 'P', 'V', 'S', '1' };
+    const uint32_t PVS_VERSION = 1;
+    const float RAY_EPSILON = 1e-6f;
+
+    struct Triangle {
+        glm::vec3 v0, edge1, edge2;
+        unsigned int mesh;
+    };
+
+    // Moller-Trumbore, double sided
+    float intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const Triangle& triangle) {
+        glm::vec3 p = glm::cross(direction, triangle.edge2);
+        float determinant = glm::dot(triangle.edge1, p);
+        if (std::fabs(determinant) < RAY_EPSILON) return -1.0f;
+
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - triangle.v0;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) return -1.0f;
+
+        glm::vec3 q = glm::cross(s, triangle.edge1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) return -1.0f;
+
+        return glm::dot(triangle.edge2, q) * inverseDeterminant;
+    }
+
+    void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool readVarint(const std::vector<uint8_t>& data, size_t& offset, uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35 && offset < data.size(); shift += 7) {
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // Alternating runs of clear and set bits, starting with a clear run. Mesh visibility
+    // is strongly clustered by model and node order, so runs stay short.
+    void compressBits(const std::vector<uint64_t>& bits, unsigned int count, std::vector<uint8_t>& out) {
+        out.clear();
+
+        bool current = false;
+        uint32_t run = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            bool bit = (bits[i / 64] >> (i % 64)) & 1;
+            if (bit != current) {
+                writeVarint(out, run);
+                current = bit;
+                run = 0;
+            }
+            run++;
+        }
+        writeVarint(out, run);
+    }
+
+    bool decompressBits(const std::vector<uint8_t>& data, unsigned int count, std::vector<uint64_t>& bits) {
+        bits.assign((count + 63) / 64, 0);
+
+        size_t offset = 0;
+        unsigned int position = 0;
+        bool current = false;
+        while (position < count) {
+            uint32_t run;
+            if (!readVarint(data, offset, run) || run > count - position) return false;
+
+            if (current) {
+                for (unsigned int i = position; i < position + run; i++) bits[i / 64] |= 1ull << (i % 64);
+            }
+            position += run;
+            current = !current;
+        }
+        return true;
+    }
+
+    template<typename T>
+    void writeValue(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::ifstream& file, T& value) {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+}
+
+void PVS::clear() {
+    meshCount = 0;
+    cellCounts = glm::ivec3(0);
+    cellBits.clear();
+}
+
+void PVS::bake(std::vector<Model>& models, const PVSBakeSettings& settings) {
+    clear();
+
+    std::vector<Triangle> triangles;
+    std::vector<BoundingBox> triangleBounds;
+    std::vector<BoundingBox> meshBounds;
+    glm::vec3 sceneMin(FLT_MAX), sceneMax(-FLT_MAX);
+
+    for (Model& model : models) {
+        model.updateBounds();
+
+        for (Mesh& mesh : model.meshes) {
+            unsigned int meshIndex = static_cast<unsigned int>(meshBounds.size());
+            meshBounds.push_back(mesh.worldAABB);
+            sceneMin = glm::min(sceneMin, glm::vec3(mesh.worldAABB.minPoint));
+            sceneMax = glm::max(sceneMax, glm::vec3(mesh.worldAABB.maxPoint));
+
+            glm::mat4 matrix = mesh.model_matrix * model.model_matrix;
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                glm::vec3 a = glm::vec3(matrix * glm::vec4(mesh.vertices[mesh.indices[i]].Position, 1.0f));
+                glm::vec3 b = glm::vec3(matrix * glm::vec4(mesh.vertices[mesh.indices[i + 1]].Position, 1.0f));
+                glm::vec3 c = glm::vec3(matrix * glm::vec4(mesh.vertices[mesh.indices[i + 2]].Position, 1.0f));
+                triangles.push_back({ a, b - a, c - a, meshIndex });
+
+                BoundingBox bounds;
+                bounds.minPoint = glm::vec4(glm::min(glm::min(a, b), c), 1.0f);
+                bounds.maxPoint = glm::vec4(glm::max(glm::max(a, b), c), 1.0f);
+                bounds.isInitialized = true;
+                triangleBounds.push_back(bounds);
+            }
+        }
+    }
+
+    meshCount = static_cast<unsigned int>(meshBounds.size());
+    if (meshCount == 0 || triangles.empty()) return;
+
+    BVH triangleBVH;
+    triangleBVH.build(triangleBounds);
+
+    auto castRay = [&](const glm::vec3& rayOrigin, const glm::vec3& direction, float maxDistance, float& hitDistance) {
+        int item = triangleBVH.raycast(rayOrigin, direction, maxDistance,
+            [&](unsigned int triangle) { return intersectTriangle(rayOrigin, direction, triangles[triangle]); }, hitDistance);
+        return item < 0 ? -1 : static_cast<int>(triangles[item].mesh);
+    };
+
+    cellSize = settings.cellSize;
+    origin = sceneMin;
+    cellCounts = glm::max(glm::ivec3(glm::ceil((sceneMax - sceneMin) / cellSize)), glm::ivec3(1));
+
+    int cellTotal = cellCounts.x * cellCounts.y * cellCounts.z;
+    cellBits.assign(cellTotal, {});
+    float sceneDiagonal = glm::length(sceneMax - sceneMin);
+
+    auto bakeCell = [&](int cell) {
+        glm::ivec3 coords(cell % cellCounts.x, (cell / cellCounts.x) % cellCounts.y, cell / (cellCounts.x * cellCounts.y));
+        glm::vec3 cellMin = origin + glm::vec3(coords) * cellSize;
+        glm::vec3 cellMax = cellMin + glm::vec3(cellSize);
+        glm::vec3 center = (cellMin + cellMax) * 0.5f;
+
+        float floorDistance;
+        if (castRay(center, glm::vec3(0.0f, -1.0f, 0.0f), settings.maxFloorDistance, floorDistance) < 0) return;
+
+        // Seeded per cell so a bake is reproducible regardless of thread scheduling
+        std::mt19937 generator(static_cast<unsigned int>(cell));
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        auto randomPoint = [&](const glm::vec3& minPoint, const glm::vec3& maxPoint) {
+            return minPoint + (maxPoint - minPoint) * glm::vec3(unit(generator), unit(generator), unit(generator));
+        };
+
+        // Viewpoints stay above the floor that made this cell walkable
+        glm::vec3 sampleMin(cellMin.x, std::max(cellMin.y, center.y - floorDistance + 0.01f), cellMin.z);
+        std::vector<glm::vec3> samples(std::max(settings.samplesPerCell, 1));
+        for (glm::vec3& sample : samples) sample = randomPoint(sampleMin, cellMax);
+
+        std::vector<uint64_t> bits((meshCount + 63) / 64, 0);
+        auto isMarked = [&](unsigned int mesh) { return (bits[mesh / 64] >> (mesh % 64)) & 1; };
+        auto mark = [&](unsigned int mesh) { bits[mesh / 64] |= 1ull << (mesh % 64); };
+
+        for (unsigned int mesh = 0; mesh < meshCount; mesh++) {
+            const BoundingBox& bounds = meshBounds[mesh];
+            if (glm::all(glm::lessThanEqual(glm::vec3(bounds.minPoint), cellMax)) &&
+                glm::all(glm::greaterThanEqual(glm::vec3(bounds.maxPoint), cellMin))) {
+                mark(mesh);
+            }
+        }
+
+        // Uniform directions catch large meshes whose bounds are mostly hidden
+        float hitDistance;
+        for (const glm::vec3& sample : samples) {
+            for (int i = 0; i < settings.randomRaysPerSample; i++) {
+                float z = unit(generator) * 2.0f - 1.0f;
+                float phi = unit(generator) * 6.28318530718f;
+                float radius = std::sqrt(std::max(0.0f, 1.0f - z * z));
+                glm::vec3 direction(radius * std::cos(phi), radius * std::sin(phi), z);
+
+                int hitMesh = castRay(sample, direction, sceneDiagonal, hitDistance);
+                if (hitMesh >= 0) mark(hitMesh);
+            }
+        }
+
+        // Targeted rays: a mesh is visible once a ray reaches a point in its bounds unblocked
+        for (unsigned int mesh = 0; mesh < meshCount; mesh++) {
+            if (isMarked(mesh)) continue;
+
+            glm::vec3 meshMin(meshBounds[mesh].minPoint), meshMax(meshBounds[mesh].maxPoint);
+            for (int i = 0; i < settings.raysPerMesh; i++) {
+                const glm::vec3& sample = samples[i % samples.size()];
+                glm::vec3 direction = randomPoint(meshMin, meshMax) - sample;
+                float distance = glm::length(direction);
+                if (distance < RAY_EPSILON) {
+                    mark(mesh);
+                    break;
+                }
+
+                int hitMesh = castRay(sample, direction / distance, distance, hitDistance);
+                if (hitMesh < 0 || hitMesh == static_cast<int>(mesh)) {
+                    mark(mesh);
+                    break;
+                }
+            }
+        }
+
+        cellBits[cell] = std::move(bits);
+    };
+
+    auto bakeCells = [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) bakeCell(static_cast<int>(cell));
+    };
+
+    // A fixed thread count gets a pool of its own, the caller counts as one of the threads
+    if (settings.threadCount != 0) {
+        ThreadPool pool(settings.threadCount - 1);
+        pool.parallelFor(cellTotal, 1, bakeCells);
+    }
+    else {
+        ThreadPool::shared().parallelFor(cellTotal, 1, bakeCells);
+    }
+}
+
+bool PVS::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Could not open PVS file for writing: " << path << "\n";
+        return false;
+    }
+
+    file.write(PVS_MAGIC, sizeof(PVS_MAGIC));
+    writeValue(file, PVS_VERSION);
+    writeValue(file, static_cast<uint32_t>(meshCount));
+    writeValue(file, cellCounts);
+    writeValue(file, origin);
+    writeValue(file, cellSize);
+
+    // Unbaked cells are stored as a zero length entry
+    std::vector<uint8_t> compressed;
+    for (const std::vector<uint64_t>& bits : cellBits) {
+        if (bits.empty()) {
+            compressed.clear();
+        }
+        else {
+            compressBits(bits, meshCount, compressed);
+        }
+
+        writeValue(file, static_cast<uint32_t>(compressed.size()));
+        file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool PVS::load(const std::string& path) {
+    clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    uint32_t version = 0, fileMeshCount = 0;
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, PVS_MAGIC) ||
+        !readValue(file, version) || version != PVS_VERSION) {
+        std::cout << "Invalid PVS file: " << path << "\n";
+        return false;
+    }
+
+    glm::ivec3 counts;
+    if (!readValue(file, fileMeshCount) || !readValue(file, counts) || !readValue(file, origin) ||
+        !readValue(file, cellSize) || glm::any(glm::lessThan(counts, glm::ivec3(1)))) {
+        std::cout << "Invalid PVS file: " << path << "\n";
+        return false;
+    }
+
+    // Every cell stores at least its 4 byte size, so a header claiming more cells than the
+    // rest of the file can hold is corrupt and must not size any allocation
+    std::streampos cellsStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t remaining = static_cast<uint64_t>(file.tellg() - cellsStart);
+    file.seekg(cellsStart);
+    if (!file) return false;
+
+    // Checked one factor at a time so the product can't overflow either
+    uint64_t maxCells = remaining / sizeof(uint32_t);
+    size_t cellCount = 1;
+    for (int axis = 0; axis < 3; axis++) {
+        if (static_cast<uint64_t>(counts[axis]) > maxCells / cellCount) {
+            std::cout << "Truncated PVS file: " << path << "\n";
+            return false;
+        }
+        cellCount *= static_cast<size_t>(counts[axis]);
+    }
+
+    std::vector<std::vector<uint64_t>> bits(cellCount);
+    std::vector<uint8_t> compressed;
+    for (std::vector<uint64_t>& cell : bits) {
+        uint32_t size;
+        if (!readValue(file, size) || size > remaining) {
+            std::cout << "Truncated PVS file: " << path << "\n";
+            return false;
+        }
+        if (size == 0) continue;
+
+        compressed.resize(size);
+        if (!file.read(reinterpret_cast<char*>(compressed.data()), size) || !decompressBits(compressed, fileMeshCount, cell)) {
+            std::cout << "Corrupt PVS file: " << path << "\n";
+            return false;
+        }
+    }
+
+    meshCount = fileMeshCount;
+    cellCounts = counts;
+    cellBits = std::move(bits);
+    return true;
+}
+
+int PVS::findCell(const glm::vec3& position) const {
+    if (empty()) return -1;
+
+    glm::ivec3 coords = glm::ivec3(glm::floor((position - origin) / cellSize));
+    if (glm::any(glm::lessThan(coords, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(coords, cellCounts))) return -1;
+
+    int cell = coords.x + cellCounts.x * (coords.y + cellCounts.y * coords.z);
+    return cellBits[cell].empty() ? -1 : cell;
+}
+
+unsigned int PVS::countVisible(int cell) const {
+    unsigned int count = 0;
+    for (uint64_t word : cellBits[cell]) count += static_cast<unsigned int>(std::bitset<64>(word).count());
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/model.h"
+
+struct PVSBakeSettings {
+    float cellSize = 2.0f;
+
+    // A cell is walkable when there is floor at most this far below its center
+    float maxFloorDistance = 4.0f;
+
+    int samplesPerCell = 16;
+    int raysPerMesh = 32;
+    int randomRaysPerSample = 64;
+
+    // 0 uses every hardware thread
+    unsigned int threadCount = 0;
+};
+
+// Precomputed per-cell mesh visibility for static scenes. Meshes are referred to by
+// their index in the flattened scene (models in order, meshes in order), which is
+// the same order GLEngine::updateScene builds sceneMeshes in.
+class PVS {
+public:
+    // Splits the scene bounds into cubic cells and ray casts from sample points in every
+    // walkable cell towards each mesh. Models must already have their final transforms.
+    void bake(std::vector<Model>& models, const PVSBakeSettings& settings);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    void clear();
+
+    // -1 outside the grid or in a cell that was not baked
+    int findCell(const glm::vec3& position) const;
+    bool isVisible(int cell, unsigned int mesh) const {
+        return (cellBits[cell][mesh / 64] >> (mesh % 64)) & 1;
+    }
+
+    bool empty() const { return cellBits.empty(); }
+    unsigned int getMeshCount() const { return meshCount; }
+    unsigned int countVisible(int cell) const;
+
+private:
+    unsigned int meshCount = 0;
+    glm::vec3 origin = glm::vec3(0.0f);
+    float cellSize = 1.0f;
+    glm::ivec3 cellCounts = glm::ivec3(0);
+
+    // One bitset per cell, empty for cells that were not baked
+    std::vector<std::vector<uint64_t>> cellBits;
+};
\ No newline at end of file
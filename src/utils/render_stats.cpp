@@ -0,0 +1,164 @@
+#include "render_stats.h"
+
+#include <algorithm>
+
+RenderStats* RenderStats::active = nullptr;
+
+void PassStats::reset() {
+    drawCalls = triangles = instances = dispatches = 0;
+    programBinds = vaoBinds = textureBinds = uniformUploads = 0;
+    framebufferBinds = bufferBinds = redundantBinds = 0;
+    gpuCounted = false;
+}
+
+void PassStats::add(const PassStats& other) {
+    drawCalls += other.drawCalls;
+    triangles += other.triangles;
+    instances += other.instances;
+    dispatches += other.dispatches;
+    programBinds += other.programBinds;
+    vaoBinds += other.vaoBinds;
+    textureBinds += other.textureBinds;
+    uniformUploads += other.uniformUploads;
+    framebufferBinds += other.framebufferBinds;
+    bufferBinds += other.bufferBinds;
+    redundantBinds += other.redundantBinds;
+    gpuCounted |= other.gpuCounted;
+}
+
+const PassStats* FrameStats::findPass(const std::string& name) const {
+    for (const PassStats& pass : passes) {
+        if (pass.name == name) return &pass;
+    }
+    return nullptr;
+}
+
+RenderStats::RenderStats() {
+    for (std::vector<float>& values : history) {
+        values.assign(HISTORY_SIZE, 0.0f);
+    }
+}
+
+void RenderStats::beginFrame() {
+    auto now = std::chrono::high_resolution_clock::now();
+
+    if (hasFrame) {
+        FrameStats& frame = frames[currentFrame];
+        frame.passes.resize(passCount);
+        frame.total.reset();
+        for (const PassStats& pass : frame.passes) {
+            frame.total.add(pass);
+        }
+        frame.frameTime = std::chrono::duration<float, std::milli>(now - frameStart).count();
+
+        recordHistory(frame);
+        currentFrame = 1 - currentFrame;
+    }
+
+    hasFrame = true;
+    frameStart = now;
+    passCount = 0;
+    for (CullStats& stage : frames[currentFrame].culling) {
+        stage = {};
+    }
+}
+
+void RenderStats::beginPass(const std::string& name) {
+    // Pass entries are reused across frames, so a stable pass list costs no allocations
+    std::vector<PassStats>& passes = frames[currentFrame].passes;
+    if (passCount == passes.size()) passes.emplace_back();
+
+    PassStats& pass = passes[passCount];
+    if (pass.name != name) pass.name = name;
+    pass.reset();
+
+    currentPassIndex = passCount++;
+}
+
+PassStats& RenderStats::currentPass() {
+    if (passCount == 0) beginPass("Frame");
+    return frames[currentFrame].passes[currentPassIndex];
+}
+
+void RenderStats::countDraw(unsigned int triangles, unsigned int instances) {
+    if (!active) return;
+
+    PassStats& pass = active->currentPass();
+    pass.drawCalls++;
+    pass.triangles += triangles * instances;
+    pass.instances += instances;
+}
+
+void RenderStats::countMultiDraw(unsigned int triangles, unsigned int draws) {
+    if (!active) return;
+
+    PassStats& pass = active->currentPass();
+    pass.drawCalls++;
+    pass.triangles += triangles;
+    pass.instances += draws;
+}
+
+void RenderStats::countGPUMultiDraw() {
+    if (!active) return;
+
+    PassStats& pass = active->currentPass();
+    pass.drawCalls++;
+    pass.gpuCounted = true;
+}
+
+void RenderStats::countDispatch() {
+    if (active) active->currentPass().dispatches++;
+}
+
+void RenderStats::countCulling(CullStage stage, unsigned int tested, unsigned int culled) {
+    if (!active) return;
+
+    CullStats& stats = active->frames[active->currentFrame].culling[stage];
+    stats.tested += tested;
+    stats.culled += culled;
+}
+
+void RenderStats::countGPUCulling(CullStage stage, unsigned int tested) {
+    if (!active) return;
+
+    CullStats& stats = active->frames[active->currentFrame].culling[stage];
+    stats.tested += tested;
+    stats.culledUnknown = true;
+}
+
+void RenderStats::recordHistory(const FrameStats& frame) {
+    const PassStats& total = frame.total;
+    float values[METRIC_COUNT] = {
+        frame.frameTime,
+        (float)total.drawCalls,
+        (float)total.triangles,
+        (float)total.instances,
+        (float)total.programBinds,
+        (float)total.vaoBinds,
+        (float)total.textureBinds,
+        (float)total.uniformUploads,
+        (float)total.redundantBinds
+    };
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        history[i][historyOffset] = values[i];
+    }
+    historyOffset = (historyOffset + 1) % HISTORY_SIZE;
+}
+
+float RenderStats::getHistoryMax(StatsMetric metric) const {
+    return *std::max_element(history[metric].begin(), history[metric].end());
+}
+
+const char* RenderStats::getMetricName(StatsMetric metric) {
+    static const char* names[METRIC_COUNT] = {
+        "Frame time (ms)", "Draw calls", "Triangles", "Instances",
+        "Program binds", "VAO binds", "Texture binds", "Uniform uploads", "Redundant binds"
+    };
+    return names[metric];
+}
+
+const char* RenderStats::getStageName(CullStage stage) {
+    static const char* names[CULL_STAGE_COUNT] = { "Frustum", "PVS", "Software occlusion", "GPU" };
+    return names[stage];
+}
\ No newline at end of file
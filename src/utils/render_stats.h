@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+enum CullStage {
+    CULL_FRUSTUM = 0,
+    CULL_PVS,
+    CULL_OCCLUSION,
+    CULL_GPU,
+    CULL_STAGE_COUNT
+};
+
+enum StatsMetric {
+    METRIC_FRAME_TIME = 0,
+    METRIC_DRAW_CALLS,
+    METRIC_TRIANGLES,
+    METRIC_INSTANCES,
+    METRIC_PROGRAM_BINDS,
+    METRIC_VAO_BINDS,
+    METRIC_TEXTURE_BINDS,
+    METRIC_UNIFORM_UPLOADS,
+    METRIC_REDUNDANT_BINDS,
+    METRIC_COUNT
+};
+
+struct PassStats {
+    std::string name;
+
+    unsigned int drawCalls = 0;
+    unsigned int triangles = 0;
+    unsigned int instances = 0;
+    unsigned int dispatches = 0;
+
+    unsigned int programBinds = 0;
+    unsigned int vaoBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int uniformUploads = 0;
+    unsigned int framebufferBinds = 0;
+    unsigned int bufferBinds = 0;
+
+    // Binds GLState skipped because the object was already bound
+    unsigned int redundantBinds = 0;
+
+    // Some multi-draws took their count from the GPU, so triangles and instances miss them
+    bool gpuCounted = false;
+
+    void reset();
+    void add(const PassStats& other);
+};
+
+struct CullStats {
+    unsigned int tested = 0;
+    unsigned int culled = 0;
+
+    // The culling ran on the GPU and culled was never read back
+    bool culledUnknown = false;
+};
+
+struct FrameStats {
+    std::vector<PassStats> passes;
+    PassStats total;
+    CullStats culling[CULL_STAGE_COUNT];
+
+    // CPU time between two beginFrame calls
+    float frameTime = 0.0f;
+
+    const PassStats* findPass(const std::string& name) const;
+};
+
+// Per-frame, per-pass counters. Shader, ComputeShader and the engines report to
+// the active instance, so counting stays a pointer check when nothing listens.
+class RenderStats {
+public:
+    static const int HISTORY_SIZE = 240;
+    static RenderStats* active;
+
+    RenderStats();
+
+    // Closes the previous frame into its history and starts counting a new one
+    void beginFrame();
+    void beginPass(const std::string& name);
+
+    static void countDraw(unsigned int triangles, unsigned int instances = 1);
+    // One multi-draw call submitting several draws, triangles is their total
+    static void countMultiDraw(unsigned int triangles, unsigned int draws);
+    // A multi-draw whose draw count only the GPU knows
+    static void countGPUMultiDraw();
+    static void countDispatch();
+    static void countCulling(CullStage stage, unsigned int tested, unsigned int culled);
+    static void countGPUCulling(CullStage stage, unsigned int tested);
+    static void countProgramBind() { if (active) active->currentPass().programBinds++; }
+    static void countVAOBind(unsigned int count = 1) { if (active) active->currentPass().vaoBinds += count; }
+    static void countTextureBind(unsigned int count = 1) { if (active) active->currentPass().textureBinds += count; }
+    static void countUniformUpload() { if (active) active->currentPass().uniformUploads++; }
+    static void countFramebufferBind() { if (active) active->currentPass().framebufferBinds++; }
+    static void countBufferBind() { if (active) active->currentPass().bufferBinds++; }
+    static void countRedundantBind() { if (active) active->currentPass().redundantBinds++; }
+
+    // Last completed frame
+    const FrameStats& getFrame() const { return frames[1 - currentFrame]; }
+
+    // Ring buffer of HISTORY_SIZE values, the oldest one at getHistoryOffset()
+    const std::vector<float>& getHistory(StatsMetric metric) const { return history[metric]; }
+    int getHistoryOffset() const { return historyOffset; }
+    float getHistoryMax(StatsMetric metric) const;
+
+    static const char* getMetricName(StatsMetric metric);
+    static const char* getStageName(CullStage stage);
+
+private:
+    FrameStats frames[2];
+    int currentFrame = 0;
+    size_t currentPassIndex = 0;
+    size_t passCount = 0;
+
+    std::vector<float> history[METRIC_COUNT];
+    int historyOffset = 0;
+
+    std::chrono::high_resolution_clock::time_point frameStart;
+    bool hasFrame = false;
+
+    PassStats& currentPass();
+    void recordHistory(const FrameStats& frame);
+};
\ No newline at end of file
@@ -1,172 +1,144 @@
 #include "shader.h"
+#include "render_stats.h"
+#include "gl_state.h"
+
+#include <algorithm>
 
 Shader::Shader() {}
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath, 
-    const char* geoPath) {
-    const string shaderPath = "../shaders/";
-
-    string convertedVertexPath = shaderPath + vertexPath;
-    string convertedFragmentPath = shaderPath + fragmentPath;
-    string convertedGeometryPath;
-    if (geoPath != nullptr) convertedGeometryPath = shaderPath + geoPath;
-
-    string vertexCode;
-    string fragmentCode;
-    string geoCode;
-    ifstream vShaderFile;
-    ifstream fShaderFile;
-    ifstream gShaderFile;
-
-    vShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-    fShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-    gShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
+    const char* geoPath, ShaderDefines defines) : defines(std::move(defines)) {
+    paths = { vertexPath, fragmentPath };
+    if (geoPath != nullptr) paths.push_back(geoPath);
 
-    try {
-        vShaderFile.open(convertedVertexPath.c_str());
-        fShaderFile.open(convertedFragmentPath.c_str());
-        stringstream vShaderStream, fShaderStream;
-
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-
-        vShaderFile.close();
-        fShaderFile.close();
-
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+    ID = ProgramBuilder::start(loadStages(), pending);
+}
 
-        if (geoPath != nullptr) {
-            gShaderFile.open(convertedGeometryPath.c_str());
-            stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geoCode = gShaderStream.str();
-        }
-    } catch (ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << e.what() << std::endl;
+std::vector<ShaderStage> Shader::loadStages() {
+    static const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+    static const char* const names[] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+
+    files.clear();
+    std::vector<ShaderStage> stages;
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::vector<std::string> stageFiles;
+        ShaderStage stage = { types[i], names[i], {}, 0 };
+        stage.source = ProgramBuilder::preprocess(paths[i], defines, stageFiles, &stage.hash);
+        stages.push_back(stage);
+        files.insert(files.end(), stageFiles.begin(), stageFiles.end());
     }
+    return stages;
+}
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-
-    unsigned int vertex, fragment;
+bool Shader::usesFile(std::string_view path) const {
+    return std::find(files.begin(), files.end(), path) != files.end();
+}
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+void Shader::reload() {
+    if (reloadID != 0) ProgramBuilder::cancel(reloadID, reloadPending);
+    reloadID = ProgramBuilder::start(loadStages(), reloadPending);
+}
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+bool Shader::applyReload() {
+    if (reloadID == 0 || !ProgramBuilder::isComplete(reloadID, reloadPending)) return false;
 
-    unsigned int geometry;
-    if (geoPath != nullptr) {
-        const char* gShaderCode = geoCode.c_str();
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
+    unsigned int program = reloadID;
+    reloadID = 0;
+    if (!ProgramBuilder::finish(program, reloadPending)) {
+        std::cout << "Keeping the previous program for " << paths[0] << "\n";
+        GLState::deleteProgram(program);
+        return false;
     }
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geoPath != nullptr) {
-        glAttachShader(ID, geometry);
-    }
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    ProgramBuilder::finish(ID, pending);
+    GLState::deleteProgram(ID);
+    ID = program;
+    uniforms.reflect(ID);
+    linked = true;
+    return true;
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (geoPath != nullptr) {
-        glDeleteShader(geometry);
-    }
+void Shader::ensureLinked() const {
+    if (linked) return;
+    linked = true;
+
+    ProgramBuilder::finish(ID, pending);
+    uniforms.reflect(ID);
 }
 
 void Shader::use() {
-    glUseProgram(ID);
+    ensureLinked();
+    GLState::useProgram(ID);
 }
 
-void Shader::setBool(const std::string &name, bool value) const
-{         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+void Shader::setBool(UniformHandle uniform, bool value) const
+{
+    glProgramUniform1i(ID, uniform.location, (int)value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setInt(const std::string &name, int value) const
-{ 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+    glProgramUniform1i(ID, uniform.location, value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setFloat(const std::string &name, float value) const
-{ 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+void Shader::setFloat(UniformHandle uniform, float value) const
+{
+    glProgramUniform1f(ID, uniform.location, value);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
-{ 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+void Shader::setVec2(UniformHandle uniform, const glm::vec2 &value) const
+{
+    glProgramUniform2fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
-void Shader::setVec2(const std::string &name, float x, float y) const
-{ 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+// ------------------------------------------------------------------------
+void Shader::setVec3(UniformHandle uniform, const glm::vec3 &value) const
+{
+    glProgramUniform3fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
-{ 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+void Shader::setVec4(UniformHandle uniform, const glm::vec4 &value) const
+{
+    glProgramUniform4fv(ID, uniform.location, 1, &value[0]);
+    RenderStats::countUniformUpload();
 }
-void Shader::setVec3(const std::string &name, float x, float y, float z) const
-{ 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+// ------------------------------------------------------------------------
+void Shader::setMat2(UniformHandle uniform, const glm::mat2 &mat) const
+{
+    glProgramUniformMatrix2fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
-{ 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+void Shader::setMat3(UniformHandle uniform, const glm::mat3 &mat) const
+{
+    glProgramUniformMatrix3fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
-void Shader::setVec4(const std::string &name, float x, float y, float z, float w) 
-{ 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+// ------------------------------------------------------------------------
+void Shader::setMat4(UniformHandle uniform, const glm::mat4 &mat) const
+{
+    glProgramUniformMatrix4fv(ID, uniform.location, 1, GL_FALSE, &mat[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
+void Shader::setVec3Array(UniformHandle uniform, const glm::vec3 *values, int count) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glProgramUniform3fv(ID, uniform.location, std::min(count, uniform.size), &values[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
+void Shader::setVec4Array(UniformHandle uniform, const glm::vec4 *values, int count) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glProgramUniform4fv(ID, uniform.location, std::min(count, uniform.size), &values[0][0]);
+    RenderStats::countUniformUpload();
 }
 // ------------------------------------------------------------------------
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
+void Shader::setMat4Array(UniformHandle uniform, const glm::mat4 *values, int count) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-}
-    
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
-    int success;
-    char infoLog[1024];
-    if (type != "PROGRAM")
-    {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
-    else
-    {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success)
-        {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
+    glProgramUniformMatrix4fv(ID, uniform.location, std::min(count, uniform.size), GL_FALSE, &values[0][0][0]);
+    RenderStats::countUniformUpload();
 }
\ No newline at end of file
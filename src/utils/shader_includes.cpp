@@ -0,0 +1,58 @@
+#include "shader_includes.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+namespace {
+    void expand(const std::string& path, const std::string* prelude, std::string& out, std::vector<std::string>& files,
+        const ShaderFileReader& readFile) {
+        std::string source = readFile(path);
+        std::string index = std::to_string(files.size());
+        files.push_back(path);
+
+        std::istringstream lines(source);
+        std::string line;
+        for (int number = 1; std::getline(lines, line); number++) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            size_t start = line.find_first_not_of(" \t");
+            std::string_view directive = start == std::string::npos ? std::string_view() : std::string_view(line).substr(start);
+
+            // Defines have to follow #version, which must stay the first line
+            if (prelude != nullptr && directive.rfind("#version", 0) == 0) {
+                out += line + "\n" + *prelude + "#line " + std::to_string(number + 1) + " " + index + "\n";
+                prelude = nullptr;
+                continue;
+            }
+
+            if (directive.rfind("#include", 0) != 0) {
+                out += line + "\n";
+                continue;
+            }
+
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cout << "ERROR::SHADER::BAD_INCLUDE " << path << ":" << number << "\n";
+                out += "\n";
+                continue;
+            }
+
+            std::filesystem::path included = std::filesystem::path(path).parent_path() / line.substr(open + 1, close - open - 1);
+            std::string includedPath = included.lexically_normal().generic_string();
+            if (std::find(files.begin(), files.end(), includedPath) == files.end()) {
+                out += "#line 1 " + std::to_string(files.size()) + "\n";
+                expand(includedPath, nullptr, out, files, readFile);
+            }
+            out += "#line " + std::to_string(number + 1) + " " + index + "\n";
+        }
+    }
+}
+
+void expandShaderIncludes(const std::string& path, const std::string& prelude, std::string& out, std::vector<std::string>& files,
+    const ShaderFileReader& readFile) {
+    expand(path, &prelude, out, files, readFile);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Include expansion shared by ProgramBuilder and the shader_embedder build step, so the
+// embedded copies and sources read at runtime get the same layout. Needs no GL context.
+// readFile returns the contents of a path relative to the shader directory.
+using ShaderFileReader = std::function<std::string(const std::string&)>;
+
+// Appends path to out with its #include "file" lines expanded, each file at most once.
+// Includes are relative to the including file. files receives path and everything it
+// pulled in, #line directives use the position in that list as source string number.
+// prelude goes right after #version, which must stay the first line.
+void expandShaderIncludes(const std::string& path, const std::string& prelude, std::string& out, std::vector<std::string>& files,
+    const ShaderFileReader& readFile);
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "shader_variants.h"
+
+ShaderVariants::ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> flagNames,
+    ShaderDefines defines) : vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath)),
+    flagNames(std::move(flagNames)), defines(std::move(defines)) {}
+
+Shader& ShaderVariants::get(unsigned int flags) {
+    auto variant = variants.find(flags);
+    if (variant != variants.end()) return variant->second;
+
+    ShaderDefines variantDefines = defines;
+    for (size_t bit = 0; bit < flagNames.size(); bit++) {
+        if (flags & (1u << bit)) variantDefines[flagNames[bit]] = "1";
+    }
+
+    Shader& shader = variants[flags];
+    shader = Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, std::move(variantDefines));
+    return shader;
+}
+
+void ShaderVariants::reload(std::string_view file) {
+    for (auto& variant : variants) {
+        if (variant.second.usesFile(file)) variant.second.reload();
+    }
+}
+
+bool ShaderVariants::applyReload() {
+    bool changed = false;
+    for (auto& variant : variants) {
+        changed |= variant.second.applyReload();
+    }
+    return changed;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "shader.h"
+
+// One vertex/fragment pair built once per combination of flags, so material and feature
+// switches become preprocessor branches instead of uniforms. Bit i of a flag set adds
+// "#define flagNames[i] 1". A variant compiles the first time it is asked for and stays
+// cached; with parallel compile it builds in the background until it is first used.
+class ShaderVariants {
+public:
+    ShaderVariants() {}
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::vector<std::string> flagNames,
+        ShaderDefines defines = {});
+
+    Shader& get(unsigned int flags);
+
+    // Hot reload for every variant built so far, see Shader
+    void reload(std::string_view file);
+    bool applyReload();
+
+    size_t size() const { return variants.size(); }
+
+private:
+    std::string vertexPath, fragmentPath;
+    std::vector<std::string> flagNames;
+    ShaderDefines defines;
+
+    // Map nodes don't move, so references handed out by get() stay valid
+    std::map<unsigned int, Shader> variants;
+};
\ No newline at end of file
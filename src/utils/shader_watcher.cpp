@@ -0,0 +1,120 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+ShaderWatcher::~ShaderWatcher() {
+    stop();
+}
+
+#ifdef __linux__
+
+bool ShaderWatcher::start(const std::string& directory) {
+    stop();
+    root = directory;
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cout << "Could not start watching " << directory << " for shader changes" << "\n";
+        return false;
+    }
+
+    // inotify isn't recursive, every subdirectory gets its own watch. Editors that save by
+    // renaming a temporary file over the original show up as IN_MOVED_TO.
+    std::error_code error;
+    auto addWatch = [this](const fs::path& path, const std::string& relative) {
+        int watch = inotify_add_watch(inotifyFd, path.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch >= 0) watchDirectories[watch] = relative;
+    };
+
+    addWatch(root, "");
+    for (fs::recursive_directory_iterator it(root, error), end; it != end; it.increment(error)) {
+        if (it->is_directory()) addWatch(it->path(), fs::relative(it->path(), root).generic_string() + "/");
+    }
+
+    watching = true;
+    return true;
+}
+
+void ShaderWatcher::stop() {
+    if (inotifyFd >= 0) close(inotifyFd);
+    inotifyFd = -1;
+    watchDirectories.clear();
+    watching = false;
+}
+
+std::vector<std::string> ShaderWatcher::poll() {
+    std::vector<std::string> changed;
+    if (inotifyFd < 0) return changed;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            auto directory = watchDirectories.find(event->wd);
+            if (event->len == 0 || (event->mask & IN_ISDIR) || directory == watchDirectories.end()) continue;
+
+            std::string path = directory->second + event->name;
+            if (std::find(changed.begin(), changed.end(), path) == changed.end()) changed.push_back(path);
+        }
+    }
+
+    return changed;
+}
+
+#else
+
+bool ShaderWatcher::start(const std::string& directory) {
+    stop();
+    root = directory;
+
+    scan(nullptr);
+    lastPoll = std::chrono::steady_clock::now();
+    watching = true;
+    return true;
+}
+
+void ShaderWatcher::stop() {
+    writeTimes.clear();
+    watching = false;
+}
+
+void ShaderWatcher::scan(std::vector<std::string>* changed) {
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(root, error), end; it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) continue;
+
+        fs::file_time_type time = it->last_write_time(error);
+        std::string path = fs::relative(it->path(), root, error).generic_string();
+
+        auto known = writeTimes.find(path);
+        if (known == writeTimes.end() || known->second != time) {
+            if (changed != nullptr && known != writeTimes.end()) changed->push_back(path);
+            writeTimes[path] = time;
+        }
+    }
+}
+
+std::vector<std::string> ShaderWatcher::poll() {
+    std::vector<std::string> changed;
+    if (!watching) return changed;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < pollInterval) return changed;
+    lastPoll = now;
+
+    scan(&changed);
+    return changed;
+}
+
+#endif
\ No newline at end of file
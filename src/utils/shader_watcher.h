@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports shader files that were saved, for hot reload. Uses inotify on Linux and compares
+// modification times every pollInterval elsewhere. Neither blocks, poll once per frame.
+class ShaderWatcher {
+public:
+    ShaderWatcher() = default;
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // Watches directory and everything below it
+    bool start(const std::string& directory);
+    void stop();
+
+    // Paths relative to the watched directory with '/' separators, each reported once
+    std::vector<std::string> poll();
+
+    bool isWatching() const { return watching; }
+
+    std::chrono::milliseconds pollInterval{ 250 };
+
+private:
+    std::filesystem::path root;
+    bool watching = false;
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> watchDirectories;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+    std::chrono::steady_clock::time_point lastPoll;
+
+    void scan(std::vector<std::string>* changed);
+#endif
+};
\ No newline at end of file
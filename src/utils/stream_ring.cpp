@@ -0,0 +1,112 @@
+#include "stream_ring.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+    const GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+void StreamRing::init(size_t size, unsigned int framesInFlight) {
+    GLint uniformAlignment = 256, storageAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    alignment = static_cast<size_t>(std::max(uniformAlignment, storageAlignment));
+
+    stats = {};
+    create(size, framesInFlight);
+}
+
+void StreamRing::create(size_t size, unsigned int framesInFlight) {
+    release();
+
+    frameSize = alignedSize(std::max<size_t>(size, alignment));
+    fences.assign(std::max(framesInFlight, 1u), nullptr);
+    frame = 0;
+    head = 0;
+
+    size_t totalSize = frameSize * fences.size();
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, totalSize, nullptr, MAP_FLAGS);
+    mapped = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, totalSize, MAP_FLAGS));
+
+    if (mapped == nullptr) {
+        std::cout << "Could not map stream ring of " << totalSize << " bytes" << "\n";
+    }
+}
+
+void StreamRing::release() {
+    for (unsigned int i = 0; i < fences.size(); i++) {
+        waitForFence(i);
+    }
+
+    if (buffer != 0) {
+        glUnmapNamedBuffer(buffer);
+        GLState::deleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    mapped = nullptr;
+}
+
+void StreamRing::waitForFence(unsigned int region) {
+    GLsync& fence = fences[region];
+    if (fence == nullptr) return;
+
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::high_resolution_clock::now();
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+
+        stats.lastStallTime += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        stats.stalls++;
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamRing::beginFrame(size_t requiredSize) {
+    stats.lastStallTime = 0.0f;
+
+    // Every region is still referenced by draws in flight, so growing waits for all of them
+    if (requiredSize > frameSize || buffer == 0) {
+        create(std::max(requiredSize, frameSize * 2), getFramesInFlight());
+        stats.grows++;
+    }
+
+    frame = (frame + 1) % fences.size();
+    waitForFence(frame);
+    stats.stallTime += stats.lastStallTime;
+    head = 0;
+}
+
+void StreamRing::setFramesInFlight(unsigned int framesInFlight) {
+    if (framesInFlight != getFramesInFlight()) create(frameSize, framesInFlight);
+}
+
+void StreamRing::endFrame() {
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    stats.used = head;
+    stats.wasted = frameSize - head;
+    stats.peak = std::max(stats.peak, head);
+}
+
+StreamAllocation StreamRing::allocate(size_t size) {
+    StreamAllocation allocation;
+    if (mapped == nullptr || head + size > frameSize) {
+        std::cout << "Stream ring out of space for " << size << " bytes" << "\n";
+        return allocation;
+    }
+
+    allocation.offset = frame * frameSize + head;
+    allocation.data = mapped + allocation.offset;
+    allocation.size = size;
+    head = std::min(head + alignedSize(size), frameSize);
+    return allocation;
+}
+
+void StreamRing::bindRange(GLenum target, unsigned int index, const StreamAllocation& allocation) const {
+    GLState::bindBufferRange(target, index, buffer, allocation.offset, allocation.size);
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+struct StreamAllocation {
+    // Write-only, mapped persistently and coherently: memcpy in and it is visible to GL
+    void* data = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+struct StreamStats {
+    // Frames that had to wait for the GPU to release their region, and for how long
+    unsigned int stalls = 0;
+    float stallTime = 0.0f;
+    float lastStallTime = 0.0f;
+
+    // Bytes handed out last frame and what was left of the region unused
+    size_t used = 0;
+    size_t wasted = 0;
+    size_t peak = 0;
+
+    unsigned int grows = 0;
+};
+
+// Streaming allocator over one persistently mapped buffer split into a region per frame in
+// flight. A region is fenced when its frame ends and only written again once that fence
+// signals, so uploads are plain memcpys without the driver having to synchronize.
+class StreamRing {
+public:
+    void init(size_t frameSize, unsigned int framesInFlight);
+    void release();
+
+    // Moves to the next region, waiting on its fence if the GPU is still reading it. The
+    // ring grows first when requiredSize doesn't fit a region, which drains the GPU.
+    void beginFrame(size_t requiredSize = 0);
+    void endFrame();
+
+    // Recreates the ring, waiting for every frame still in flight
+    void setFramesInFlight(unsigned int framesInFlight);
+
+    // Aligned for uniform and storage buffer ranges. Returns an empty allocation when the
+    // region is full, callers should ask beginFrame for enough space.
+    StreamAllocation allocate(size_t size);
+
+    // Upper bound of what allocate takes out of the region for size bytes
+    size_t alignedSize(size_t size) const { return (size + alignment - 1) / alignment * alignment; }
+
+    void bindRange(GLenum target, unsigned int index, const StreamAllocation& allocation) const;
+
+    unsigned int getBuffer() const { return buffer; }
+    unsigned int getFramesInFlight() const { return static_cast<unsigned int>(fences.size()); }
+    size_t getFrameSize() const { return frameSize; }
+
+    StreamStats stats;
+
+private:
+    unsigned int buffer = 0;
+    unsigned char* mapped = nullptr;
+
+    size_t frameSize = 0, alignment = 256;
+    size_t head = 0;
+    unsigned int frame = 0;
+    std::vector<GLsync> fences;
+
+    void create(size_t size, unsigned int framesInFlight);
+    void waitForFence(unsigned int region);
+};
\ No newline at end of file
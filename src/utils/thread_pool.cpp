@@ -0,0 +1,97 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+    // Set on threads that are inside a task, nested jobs would deadlock on jobMutex
+    thread_local bool insideTask = false;
+}
+
+ThreadPool::ThreadPool(unsigned int workerCount) {
+    if (workerCount == 0) workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(size_t itemCount, size_t itemGrain, const std::function<void(size_t, size_t)>& job) {
+    if (itemCount == 0) return;
+    itemGrain = std::max<size_t>(itemGrain, 1);
+
+    if (workers.empty() || insideTask || itemCount <= itemGrain) {
+        job(0, itemCount);
+        return;
+    }
+
+    std::lock_guard<std::mutex> jobLock(jobMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &job;
+        count = itemCount;
+        grain = itemGrain;
+        chunkCount = (itemCount + itemGrain - 1) / itemGrain;
+        nextChunk = 0;
+        chunksDone = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]() { return chunksDone == chunkCount && activeWorkers == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::runChunks() {
+    insideTask = true;
+
+    size_t done = 0;
+    size_t chunk;
+    while ((chunk = nextChunk++) < chunkCount) {
+        size_t begin = chunk * grain;
+        (*task)(begin, std::min(begin + grain, count));
+        done++;
+    }
+
+    insideTask = false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    chunksDone += done;
+    if (chunksDone == chunkCount) finished.notify_all();
+}
+
+void ThreadPool::workerLoop() {
+    unsigned int seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+
+            // Woken too late, the job is already handed out and its fields may get reused
+            if (nextChunk >= chunkCount) continue;
+            activeWorkers++;
+        }
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) finished.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long-lived worker threads for CPU work that needs no GL context. The calling thread joins
+// in on every job, so a pool with N workers runs jobs on N + 1 threads.
+class ThreadPool {
+public:
+    // 0 workers means one per hardware thread besides the caller
+    explicit ThreadPool(unsigned int workerCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Splits [0, count) into ranges of at most grain items and calls task(begin, end) on
+    // each, returning once all of them ran. Calls from inside a task run inline.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task);
+
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // Shared by the engine and the occlusion rasterizer
+    static ThreadPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+    unsigned int generation = 0;
+
+    // The job currently running, guarded by jobMutex so only one runs at a time. Its fields
+    // only change while no worker is inside runChunks.
+    std::mutex jobMutex;
+    const std::function<void(size_t, size_t)>* task = nullptr;
+    size_t count = 0, grain = 1, chunkCount = 0;
+    std::atomic<size_t> nextChunk{ 0 };
+    size_t chunksDone = 0;
+    unsigned int activeWorkers = 0;
+
+    void workerLoop();
+    void runChunks();
+};
\ No newline at end of file
@@ -13,4 +13,27 @@ void addBoneData(VertexBoneData& data, unsigned int boneID, float weight) {
             return;
         }
     }
+}
+
+BoundingBox BoundingBox::transform(const glm::mat4& matrix) const {
+    glm::vec3 newMin(matrix[3]);
+    glm::vec3 newMax(matrix[3]);
+
+    // Each basis column contributes independently, so taking the min/max per
+    // column gives the exact bounds of all 8 transformed corners
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 column(matrix[i]);
+        glm::vec3 a = column * minPoint[i];
+        glm::vec3 b = column * maxPoint[i];
+
+        newMin += glm::min(a, b);
+        newMax += glm::max(a, b);
+    }
+
+    BoundingBox result;
+    result.minPoint = glm::vec4(newMin, 1.0f);
+    result.maxPoint = glm::vec4(newMax, 1.0f);
+    result.isInitialized = true;
+
+    return result;
 }
\ No newline at end of file
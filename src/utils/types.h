@@ -86,4 +86,7 @@ struct BoundingBox {
     glm::vec4 maxPoint;
 
     bool isInitialized = false;
+
+    // Tight axis-aligned box around this box after an affine transform (Arvo's method)
+    BoundingBox transform(const glm::mat4& matrix) const;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "uniforms.h"
+
+#include <algorithm>
+#include <iostream>
+
+void UniformCache::reflect(unsigned int program) {
+    entries.clear();
+
+    int count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(std::max(maxLength, 1));
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+
+        std::string name(buffer.data(), length);
+        int location = glGetUniformLocation(program, name.c_str());
+
+        // Members of uniform blocks have no location
+        if (location < 0) continue;
+
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+
+            // Handles address elements as location + index, make sure the driver agrees
+            for (int j = 1; j < size; j++) {
+                if (glGetUniformLocation(program, (name + "[" + std::to_string(j) + "]").c_str()) != location + j) {
+                    std::cout << "Uniform array " << name << " has non-consecutive locations" << "\n";
+                    size = j;
+                    break;
+                }
+            }
+        }
+
+        entries.push_back({ name, { location, size } });
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+}
+
+UniformHandle UniformCache::find(std::string_view name) const {
+    auto lookup = [this](std::string_view key) -> const Entry* {
+        auto iterator = std::lower_bound(entries.begin(), entries.end(), key,
+            [](const Entry& entry, std::string_view value) { return std::string_view(entry.name) < value; });
+        return iterator != entries.end() && iterator->name == key ? &*iterator : nullptr;
+    };
+
+    if (const Entry* entry = lookup(name)) return entry->handle;
+
+    // Element of an array, e.g. "samples[12]"
+    size_t open = name.rfind('[');
+    if (open == std::string_view::npos || name.back() != ']' || open + 2 >= name.size()) return {};
+
+    int index = 0;
+    for (size_t i = open + 1; i < name.size() - 1; i++) {
+        if (name[i] < '0' || name[i] > '9') return {};
+        index = index * 10 + (name[i] - '0');
+    }
+
+    const Entry* array = lookup(name.substr(0, open));
+    return array != nullptr ? array->handle.at(index) : UniformHandle{};
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Location of an active uniform. Arrays keep the location of element 0 and their length.
+// Invalid handles hold -1, which the glProgramUniform* calls silently ignore.
+struct UniformHandle {
+    int location = -1;
+    int size = 0;
+
+    bool isValid() const { return location >= 0; }
+    UniformHandle at(int index) const {
+        return index >= 0 && index < size ? UniformHandle{ location + index, size - index } : UniformHandle{};
+    }
+};
+
+// Active uniforms of a linked program, reflected once and kept sorted by name so
+// lookups need neither driver calls nor allocations
+class UniformCache {
+public:
+    void reflect(unsigned int program);
+
+    // Accepts "name", "name[0]" and "name[i]" for arrays
+    UniformHandle find(std::string_view name) const;
+
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        std::string name;
+        UniformHandle handle;
+    };
+
+    std::vector<Entry> entries;
+};
\ No newline at end of file